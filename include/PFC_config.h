@@ -42,11 +42,48 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 #define IP_ADDR   {192, 168, 121, 177}
 #define GATEWAY 0,0,0,0
 #define SUBNET  0,0,0,0
-#define PORT    4500
+#define PORT    4500        // The single controller session
+#define TELEMETRY_PORT 4501 // Read-only telemetry sessions
+
+// Session buffers (bytes) and per-loop service budgets
+#define MAX_TELEMETRY_SESSIONS 6
+#define CONTROLLER_REPLY_SIZE 1024
+#define SESSION_RX_BUF_SIZE 256
+#define SESSION_TX_BUF_SIZE 2048
+#define SESSION_FRAME_SIZE 512
+#define SESSION_RX_BUDGET 128
+#define SESSION_TX_BUDGET 512
 
 #define UPDATE_PRD_US 100 
 #define TERM_UPDATE_PRD_SEC 0.2
 
+// Time-tagged command execution
+#define TIMED_CMD_QUEUE_DEPTH 32
+#define ENET_TS_CLK_HZ 25000000 // ENET 1588 timer input clock
+
+// Clock discipline against the host time reference
+#define CLOCK_SYNC_KP 0.5
+#define CLOCK_SYNC_KI 0.1
+#define CLOCK_SYNC_MAX_RTT_NS 5000000LL  // Discard exchanges with round trip > 5 ms
+#define CLOCK_SYNC_STEP_NS 10000000LL    // Step instead of slewing if off by > 10 ms
+
+// Default limit on setpoint messages, shared by all clients (<= 0 disables)
+#define CMD_RATE_LIMIT_PER_SEC 2000.0
+#define CMD_RATE_LIMIT_BURST 200.0
+
+// Health statistics
+#define HEALTH_EW_FAST_ALPHA 0.05      // ~20 sample time constant
+#define HEALTH_EW_SLOW_ALPHA 0.001     // ~1000 sample time constant
+#define HEALTH_MIN_SAMPLES 32          // Samples before noise/drift/RMS checks start
+#define HEALTH_WIPER_SAMPLE_PRD_US 1000
+#define HEALTH_WIPER_MAX_NOISE 8.0     // ADC counts RMS, sample to sample
+#define HEALTH_WIPER_MAX_DRIFT 0.0     // ADC counts; off, since commanded moves look like drift
+#define HEALTH_EXEC_MAX_RMS_NS 250000.0
+#define HEALTH_EXEC_MAX_DRIFT_NS 100000.0
+#define HEALTH_CLOCK_MAX_RMS_NS 500000.0
+#define HEALTH_CLOCK_MAX_DRIFT_NS 200000.0
+#define HEALTH_FRAME_SIZE 768
+
 
 #define ENABLE_TERMINAL_UPDATES 1
 
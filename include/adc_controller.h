@@ -19,8 +19,8 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 ///
 
 
-#ifndef DEVICE_CONTROLLER_H
-#define DEVICE_CONTROLLER_H
+#ifndef ADC_CONTROLLER_H
+#define ADC_CONTROLLER_H
 
 #include <Arduino.h>
 #include <LFAST_Device.h>
@@ -61,8 +61,17 @@ public:
     void doNonInterruptStuff();
 
     void doSomethingForACallback();
+
+    int getWiperPosition() const { return lastWiper; }
+
 private:
-    ADCController(){};
+    ADCController();
+
+    void sampleWiper();
+
+    uint32_t lastWiperSampleUs;
+    int lastWiper;
+    bool haveWiperSample;
 
 };
 
@@ -0,0 +1,89 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+///
+/// @brief Disciplines the local timestamp counter against a host time reference
+/// @author Kevin Gilliam
+/// @date February 16th, 2023
+/// @file clock_discipline.h
+///
+
+#ifndef CLOCK_DISCIPLINE_H
+#define CLOCK_DISCIPLINE_H
+
+#include <cstdint>
+
+namespace LFAST
+{
+    /// @brief One four-timestamp exchange with the host (NTP style).
+    ///
+    /// t1 and t4 are host times, t2 and t3 are local times, all in nanoseconds.
+    struct SyncSample
+    {
+        int64_t t1_hostTx;
+        int64_t t2_localRx;
+        int64_t t3_localTx;
+        int64_t t4_hostRx;
+    };
+
+    /// @brief Hardware-independent PI servo mapping local time to host time.
+    ///
+    /// The host-minus-local offset is modelled as a straight line through the
+    /// most recent accepted sample. Every sample nudges the offset and the slope
+    /// (rate) toward the measurement. If the error is larger than the step
+    /// threshold, the model is reset to the measurement.
+    class ClockDiscipline
+    {
+    public:
+        ClockDiscipline();
+
+        /// @brief Feeds one sync exchange into the servo.
+        /// @return true if the sample was accepted (round trip short enough).
+        bool addSample(const SyncSample &sample);
+
+        int64_t toHostNs(int64_t localNs) const;
+        int64_t toLocalNs(int64_t hostNs) const;
+
+        bool isSynchronized() const { return synced; }
+        int64_t lastOffsetErrorNs() const { return lastErrorNs; }
+        int64_t lastRoundTripNs() const { return lastDelayNs; }
+        double rateCorrectionPpb() const { return rate * 1.0e9; }
+        uint32_t acceptedSamples() const { return numAccepted; }
+        uint32_t rejectedSamples() const { return numRejected; }
+
+        void setGains(double kp, double ki);
+        void setMaxRoundTripNs(int64_t ns) { maxDelayNs = ns; }
+        void setStepThresholdNs(int64_t ns) { stepThresholdNs = ns; }
+        void reset();
+
+    private:
+        int64_t offsetAt(int64_t localNs) const;
+
+        bool synced;
+        int64_t refLocalNs;
+        int64_t refOffsetNs;
+        double rate;
+
+        double kp;
+        double ki;
+        int64_t maxDelayNs;
+        int64_t stepThresholdNs;
+
+        int64_t lastErrorNs;
+        int64_t lastDelayNs;
+        uint32_t numAccepted;
+        uint32_t numRejected;
+    };
+};
+
+#endif
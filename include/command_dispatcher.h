@@ -0,0 +1,107 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+///
+/// @brief Stages setpoint commands from one TCP message and dispatches them together
+/// @author Kevin Gilliam
+/// @date February 16th, 2023
+/// @file command_dispatcher.h
+///
+
+#ifndef COMMAND_DISPATCHER_H
+#define COMMAND_DISPATCHER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "voicecoil_iface_controller.h"
+#include "rate_limiter.h"
+
+/// @brief Collects the setpoint-related keys of one message, then applies them.
+///
+/// The message handlers only stage values here. They are applied (or queued,
+/// if the message carried an ExecTime) by dispatch() once the whole message
+/// has been parsed, so key order within a message does not matter. The
+/// controller router calls beginMessage() and dispatch() around every JSON
+/// message, so nothing staged in one message leaks into the next.
+///
+/// Every setpoint received is counted once: merged (repeated key within one
+/// message, or replaced in the coalescer before a tick), dropped (rate limit
+/// or rejected timed command), or applied/queued.
+///
+/// Each message carrying setpoints costs one token from a single global
+/// bucket; messages over the limit are dropped whole. Immediate setpoints
+/// which survive go through the voice coil controller's coalescer, so a burst
+/// still costs at most one update per axis per control tick.
+///
+/// Health thresholds are staged the same way: HealthChannel picks the channel
+/// and the SetHealthMax* keys in the same message change its limits.
+class CommandDispatcher
+{
+public:
+    CommandDispatcher(VoiceCoilInterfaceController &vc);
+
+    void beginMessage();
+    void setExecTime(int64_t hostNs);
+    void stageSetpoint(uint8_t axis, double value);
+    void stageRateLimit(double cmdsPerSec);
+    void stageRateBurst(double cmds);
+    void stageHealthChannel(unsigned int channel);
+    void stageHealthMaxNoise(double limit);
+    void stageHealthMaxDrift(double limit);
+    void stageHealthMaxRms(double limit);
+    void dispatch();
+
+    uint32_t receivedSetpoints() const { return numSetpointsReceived; }
+    uint32_t mergedSetpoints() const { return numSetpointsMerged; }
+    uint32_t droppedSetpoints() const { return numSetpointsDropped; }
+    const LFAST::TokenBucket &getSetpointRateLimit() const { return setpointRateLimit; }
+
+private:
+    struct StagedCommands
+    {
+        bool hasExecTime;
+        int64_t execTimeNs;
+        bool hasSetpoint[LFAST::NUM_PFC_AXES];
+        double setpoint[LFAST::NUM_PFC_AXES];
+        bool hasRateLimit;
+        double rateLimit;
+        bool hasRateBurst;
+        double rateBurst;
+        bool hasHealthChannel;
+        unsigned int healthChannel;
+        bool hasHealthMaxNoise;
+        double healthMaxNoise;
+        bool hasHealthMaxDrift;
+        double healthMaxDrift;
+        bool hasHealthMaxRms;
+        double healthMaxRms;
+    };
+
+    void applyHealthThresholds();
+
+    VoiceCoilInterfaceController &vc;
+    StagedCommands staged;
+    LFAST::TokenBucket setpointRateLimit;
+    uint32_t numSetpointsReceived;
+    uint32_t numSetpointsMerged;
+    uint32_t numSetpointsDropped;
+};
+
+/// @brief Builds the JSON frame published to telemetry sessions.
+/// @return Length of the frame, or 0 if it did not fit in buf
+std::size_t formatTelemetryFrame(char *buf, std::size_t len,
+                                 VoiceCoilInterfaceController &vc,
+                                 const CommandDispatcher &dispatcher);
+
+#endif
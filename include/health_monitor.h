@@ -0,0 +1,139 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+///
+/// @brief Streaming, constant-memory health statistics for sensors and actuators
+/// @author Kevin Gilliam
+/// @date February 16th, 2023
+/// @file health_monitor.h
+///
+
+#ifndef HEALTH_MONITOR_H
+#define HEALTH_MONITOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LFAST
+{
+    enum HEALTH_CHANNEL
+    {
+        WIPER_POSN_CH,     // Raw ADC counts from ADC_POSN_WIPER_PIN
+        WIPER_NOISE_CH,    // Sample-to-sample change of the same, insensitive to slow moves
+        EXEC_TIME_CH,      // Timed command execution error (ns)
+        CLOCK_OFFSET_CH,   // Clock sync offset error (ns)
+        NUM_HEALTH_CHANNELS
+    };
+
+    enum HEALTH_FLAGS
+    {
+        HEALTH_OK = 0,
+        HEALTH_NOISE = 1 << 0,    // Standard deviation above maxStdDev
+        HEALTH_DRIFT = 1 << 1,    // Fast and slow averages differ by more than maxDrift
+        HEALTH_RMS = 1 << 2,      // Recent RMS above maxRms
+        HEALTH_RANGE = 1 << 3     // Sample outside [minValue, maxValue]
+    };
+
+    /// @brief A zero limit disables that check; minValue == maxValue disables the range check.
+    struct HealthThresholds
+    {
+        double maxStdDev;
+        double maxDrift;
+        double maxRms;
+        double minValue;
+        double maxValue;
+    };
+
+    /// @brief Running statistics for one channel, updated one sample at a time.
+    ///
+    /// Mean and variance use Welford's algorithm over every sample since the
+    /// last reset. The trend is the difference between a fast and a slow
+    /// exponentially weighted average, and the RMS is exponentially weighted
+    /// with the fast weight, so both follow recent behaviour.
+    class ChannelStats
+    {
+    public:
+        ChannelStats();
+
+        void reset();
+        void update(double x);
+
+        uint32_t count() const { return n; }
+        double mean() const { return runningMean; }
+        double variance() const { return n > 1 ? m2 / (double)(n - 1) : 0.0; }
+        double stdDev() const;
+        double min() const { return minValue; }
+        double max() const { return maxValue; }
+        double trend() const { return ewFast - ewSlow; }
+        double meanSquare() const { return ewSquare; }
+        double rms() const;
+
+    private:
+        uint32_t n;
+        double runningMean;
+        double m2;
+        double minValue;
+        double maxValue;
+        double ewFast;
+        double ewSlow;
+        double ewSquare;
+    };
+
+    struct HealthSnapshot
+    {
+        ChannelStats channels[NUM_HEALTH_CHANNELS];
+        uint8_t flags[NUM_HEALTH_CHANNELS];
+        uint32_t numEvents;
+    };
+
+    /// @brief Builds the compact GetHealth summary. Returns its length, or 0 if it did not fit.
+    std::size_t formatHealthSummary(char *buf, std::size_t len, const HealthSnapshot &snap);
+};
+
+/// @brief Singleton holding the statistics and thresholds for every health channel.
+///
+/// update() is cheap enough to call from the control ISR. Flags latch until
+/// clearFlags() so a transient fault is not missed. update() also modifies
+/// the event counters shared by every channel, so callers in the loop must
+/// disable interrupts around it, as they do around snapshot(),
+/// takeNewEvents() and clearFlags().
+class HealthMonitor
+{
+public:
+    static HealthMonitor &getMonitor();
+
+    void update(LFAST::HEALTH_CHANNEL ch, double x);
+    void setThresholds(LFAST::HEALTH_CHANNEL ch, const LFAST::HealthThresholds &th);
+    LFAST::HealthThresholds getThresholds(LFAST::HEALTH_CHANNEL ch) const;
+    void clearFlags();
+    void reset();
+
+    uint8_t flags(LFAST::HEALTH_CHANNEL ch) const { return channelFlags[ch]; }
+    uint8_t allFlags() const;
+    uint32_t events() const { return numEvents; }
+    uint32_t takeNewEvents();
+    LFAST::HealthSnapshot snapshot() const;
+
+    static const char *channelName(LFAST::HEALTH_CHANNEL ch);
+
+private:
+    HealthMonitor();
+
+    LFAST::ChannelStats stats[LFAST::NUM_HEALTH_CHANNELS];
+    LFAST::HealthThresholds thresholds[LFAST::NUM_HEALTH_CHANNELS];
+    uint8_t channelFlags[LFAST::NUM_HEALTH_CHANNELS];
+    uint32_t numEvents;
+    uint32_t newEventMask;
+};
+
+#endif
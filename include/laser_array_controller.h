@@ -19,8 +19,8 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 ///
 
 
-#ifndef DEVICE_CONTROLLER_H
-#define DEVICE_CONTROLLER_H
+#ifndef LASER_ARRAY_CONTROLLER_H
+#define LASER_ARRAY_CONTROLLER_H
 
 #include <Arduino.h>
 #include <LFAST_Device.h>
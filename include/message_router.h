@@ -0,0 +1,109 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+///
+/// @brief Routes the keys of one controller message to registered handlers
+/// @author Kevin Gilliam
+/// @date February 16th, 2023
+/// @file message_router.h
+///
+
+#ifndef MESSAGE_ROUTER_H
+#define MESSAGE_ROUTER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "PFC_config.h"
+
+namespace LFAST
+{
+    /// @brief Flat JSON reply built one key at a time, e.g. {"Handshake":48879}.
+    class ReplyMessage
+    {
+    public:
+        ReplyMessage();
+
+        template <typename T>
+        void addKeyValuePair(const char *key, T value);
+
+        /// @brief Closes the object. Returns the reply, or nullptr if it did not fit.
+        const char *finish(std::size_t &len);
+
+    private:
+        void appendPair(const char *key, const char *valueText);
+
+        char buf[CONTROLLER_REPLY_SIZE];
+        std::size_t len;
+        bool overflow;
+    };
+
+    template <>
+    void ReplyMessage::addKeyValuePair<double>(const char *key, double value);
+    template <>
+    void ReplyMessage::addKeyValuePair<unsigned int>(const char *key, unsigned int value);
+
+    typedef void (*MessageHook)();
+};
+
+/// @brief Calls a registered handler for every numeric key of a controller message.
+///
+/// Messages look like {"<filter>": {"Key": number, ...}}. Keys are handled in
+/// the order they appear. The begin and end hooks run around each message, so
+/// callers can stage the keys of one message and apply them together.
+class MessageRouter
+{
+public:
+    static const uint8_t MAX_HANDLERS = 32;
+    static const uint8_t MAX_KEY_LEN = 32;
+
+    MessageRouter(const char *filter);
+
+    template <typename T>
+    bool registerMessageHandler(const char *key, void (*fn)(T));
+    void setMessageHooks(LFAST::MessageHook begin, LFAST::MessageHook end);
+
+    bool route(const char *msg);
+
+    uint32_t routedMessages() const { return numRouted; }
+    uint32_t rejectedMessages() const { return numRejected; }
+    uint32_t unknownKeys() const { return numUnknownKeys; }
+
+private:
+    struct Handler
+    {
+        const char *key;
+        bool isUnsigned;
+        void (*fnDouble)(double);
+        void (*fnUnsigned)(unsigned int);
+    };
+
+    bool addHandler(const Handler &h);
+    const Handler *findHandler(const char *key) const;
+
+    const char *filter;
+    Handler handlers[MAX_HANDLERS];
+    uint8_t numHandlers;
+    LFAST::MessageHook beginHook;
+    LFAST::MessageHook endHook;
+    uint32_t numRouted;
+    uint32_t numRejected;
+    uint32_t numUnknownKeys;
+};
+
+template <>
+bool MessageRouter::registerMessageHandler<double>(const char *key, void (*fn)(double));
+template <>
+bool MessageRouter::registerMessageHandler<unsigned int>(const char *key, void (*fn)(unsigned int));
+
+#endif
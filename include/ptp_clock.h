@@ -0,0 +1,65 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+///
+/// @brief Local timestamp clock (ENET IEEE-1588 timer) disciplined to host time
+/// @author Kevin Gilliam
+/// @date February 16th, 2023
+/// @file ptp_clock.h
+///
+
+#ifndef PTP_CLOCK_H
+#define PTP_CLOCK_H
+
+#include <cstdint>
+#include "clock_discipline.h"
+
+/// @brief Singleton wrapping the local time source and its discipline.
+///
+/// On the Teensy the local time source is the ENET IEEE-1588 timer, extended
+/// to 64 bits in software. It has to be read at least once a second, so the
+/// main loop reads it on every pass (the control ISR only runs after the
+/// handshake). Host builds use std::chrono::steady_clock instead.
+class PtpClock
+{
+public:
+    static PtpClock &getClock();
+
+    void hardware_setup();
+
+    int64_t localNowNs();
+    int64_t hostNowNs();
+    int64_t hostToLocalNs(int64_t hostNs) const { return discipline.toLocalNs(hostNs); }
+
+    /// Host-initiated sync exchange: t1 arrives, t3 is stamped on reply, t4 closes it.
+    /// t2 and t3 are software stamps taken when the message is handled, not
+    /// ENET descriptor timestamps, so they carry the loop and TCP stack latency.
+    int64_t stampSyncRequest(int64_t hostT1Ns);
+    int64_t stampSyncReply();
+    bool completeSync(int64_t hostT4Ns);
+    void reset();
+
+    const LFAST::ClockDiscipline &getDiscipline() const { return discipline; }
+
+private:
+    PtpClock();
+
+    LFAST::ClockDiscipline discipline;
+    LFAST::SyncSample pending;
+    bool syncPending;
+
+    uint32_t lastRaw;
+    int64_t secondsNs;
+};
+
+#endif
@@ -0,0 +1,53 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+///
+/// @brief Token bucket rate limiting for incoming commands
+/// @author Kevin Gilliam
+/// @date February 16th, 2023
+/// @file rate_limiter.h
+///
+
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <cstdint>
+
+namespace LFAST
+{
+    /// @brief Token bucket: refills at ratePerSec up to burst tokens.
+    class TokenBucket
+    {
+    public:
+        TokenBucket();
+
+        void configure(double ratePerSec, double burst);
+        bool tryConsume(int64_t nowNs, double tokens = 1.0);
+
+        double getRate() const { return ratePerSec; }
+        double getBurst() const { return burst; }
+        uint32_t allowed() const { return numAllowed; }
+        uint32_t dropped() const { return numDropped; }
+
+    private:
+        double ratePerSec;
+        double burst;
+        double tokens;
+        int64_t lastRefillNs;
+        bool started;
+        uint32_t numAllowed;
+        uint32_t numDropped;
+    };
+};
+
+#endif
@@ -0,0 +1,175 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+///
+/// @brief TCP sessions: one controller plus read-only telemetry subscribers
+/// @author Kevin Gilliam
+/// @date February 16th, 2023
+/// @file session_server.h
+///
+
+#ifndef SESSION_SERVER_H
+#define SESSION_SERVER_H
+
+#include <Arduino.h>
+#include <NativeEthernet.h>
+#include <LFAST_Device.h>
+#include <cstddef>
+#include <cstdint>
+
+#include "PFC_config.h"
+#include "message_router.h"
+
+namespace LFAST
+{
+    /// @brief The one controller session arrives on PORT. Sessions on
+    /// TELEMETRY_PORT are read-only subscribers.
+    enum SESSION_ROLE
+    {
+        ROLE_NONE,
+        ROLE_CONTROLLER,
+        ROLE_TELEMETRY
+    };
+
+    /// @brief Fixed-size byte FIFO; writes that don't fit are refused whole.
+    template <std::size_t N>
+    class ByteRing
+    {
+    public:
+        ByteRing() : head(0), count(0) {}
+
+        std::size_t size() const { return count; }
+        std::size_t space() const { return N - count; }
+        void clear() { head = count = 0; }
+
+        bool push(const char *data, std::size_t len)
+        {
+            if (len > space())
+                return false;
+            for (std::size_t ii = 0; ii < len; ii++)
+                buf[(head + count + ii) % N] = data[ii];
+            count += len;
+            return true;
+        }
+
+        /// @brief Longest contiguous run starting at the front of the FIFO.
+        const char *front(std::size_t &len) const
+        {
+            len = (head + count <= N) ? count : N - head;
+            return &buf[head];
+        }
+
+        void pop(std::size_t len)
+        {
+            if (len > count)
+                len = count;
+            head = (head + len) % N;
+            count -= len;
+        }
+
+    private:
+        char buf[N];
+        std::size_t head;
+        std::size_t count;
+    };
+
+    struct SessionStats
+    {
+        uint32_t framesQueued;
+        uint32_t framesDropped;
+        uint32_t requests;
+        uint32_t bytesSent;
+    };
+
+    struct Session
+    {
+        EthernetClient client;
+        SESSION_ROLE role;
+        uint32_t publishPrdMs;
+        uint32_t lastPublishMs;
+        bool frameRequested;
+        char rx[SESSION_RX_BUF_SIZE];
+        std::size_t rxLen;
+        int rxDepth;
+        ByteRing<SESSION_TX_BUF_SIZE> tx;
+        SessionStats stats;
+    };
+
+    /// @brief Builds one JSON telemetry frame into buf, returns its length (0 on failure).
+    typedef std::size_t (*TelemetryFrameBuilder)(char *buf, std::size_t len);
+};
+
+/// @brief Serves the controller session and up to MAX_TELEMETRY_SESSIONS subscribers.
+///
+/// Only one client may hold the controller session on PORT. While it is
+/// connected, further clients on PORT get {"Error": "controller already
+/// connected"} and are closed. Every complete JSON object from the controller
+/// is passed to the controller router on its own, and replies go back to the
+/// controller session only.
+///
+/// Each session has its own receive and transmit buffers. service() handles
+/// the controller first, then visits the subscribers round-robin, starting one
+/// further along each call. Each session gets a fixed byte budget, so one slow
+/// or chatty client cannot starve the others or the control loop. A frame that
+/// does not fit a session's transmit buffer is dropped for that session only.
+///
+/// Subscribers may send (flat JSON, numbers only):
+///   {"Subscribe": period_ms}   0 stops periodic frames
+///   {"GetTelemetry": 0}        one frame now
+///   {"GetHealth": 0}           health summary now
+///   {"Ping": value}            replies {"Pong": value, "Session": n}
+class SessionServer : public LFAST_Device
+{
+public:
+    /// Slot 0 of the session table is reserved for the controller.
+    static const uint8_t CONTROLLER_SLOT = 0;
+    static const uint8_t NUM_SESSION_SLOTS = MAX_TELEMETRY_SESSIONS + 1;
+
+    SessionServer(unsigned int controllerPort, unsigned int telemetryPort);
+    virtual ~SessionServer() {}
+    void setupPersistentFields() override;
+
+    bool initializeEnetIface(const uint8_t mac[6], const uint8_t ip[4]);
+    void setControllerRouter(MessageRouter *router) { controllerRouter = router; }
+    void setTelemetrySource(LFAST::TelemetryFrameBuilder builder) { frameBuilder = builder; }
+    void setHealthSource(LFAST::TelemetryFrameBuilder builder) { healthBuilder = builder; }
+    void service();
+
+    bool sendToController(const char *msg, std::size_t len);
+    bool controllerConnected() const { return sessions[CONTROLLER_SLOT].role == LFAST::ROLE_CONTROLLER; }
+    uint32_t refusedControllers() const { return numRefusedControllers; }
+    uint8_t activeSessions() const;
+    const LFAST::Session *getSession(uint8_t idx) const;
+
+private:
+    void acceptController();
+    void acceptSubscribers();
+    void serviceSession(uint8_t idx, uint32_t nowMs);
+    void closeSession(LFAST::Session &s);
+    void receive(uint8_t idx);
+    void handleRequest(uint8_t idx, const char *msg);
+    void publish(uint8_t idx, uint32_t nowMs);
+    void transmit(LFAST::Session &s);
+    bool queueFrame(LFAST::Session &s, const char *frame, std::size_t len);
+
+    EthernetServer controllerServer;
+    EthernetServer telemetryServer;
+    LFAST::Session sessions[NUM_SESSION_SLOTS];
+    MessageRouter *controllerRouter;
+    LFAST::TelemetryFrameBuilder frameBuilder;
+    LFAST::TelemetryFrameBuilder healthBuilder;
+    uint8_t nextStart;
+    uint32_t numRefusedControllers;
+};
+
+#endif
@@ -0,0 +1,75 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+///
+/// @brief Latest-wins setpoint mailbox between the comms loop and the control ISR
+/// @author Kevin Gilliam
+/// @date February 16th, 2023
+/// @file setpoint_coalescer.h
+///
+
+#ifndef SETPOINT_COALESCER_H
+#define SETPOINT_COALESCER_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LFAST
+{
+    /// @brief One slot per axis. Posting to a slot which the ISR has not consumed
+    /// yet overwrites it, so however many setpoints arrive between two control
+    /// ticks, the ISR applies at most one per axis.
+    ///
+    /// Like TimeTaggedQueue, the loop side must call post() with interrupts disabled.
+    template <std::size_t NUM_AXES>
+    class SetpointCoalescer
+    {
+    public:
+        SetpointCoalescer() : pendingMask(0), numPosted(0), numMerged(0) {}
+
+        void post(uint8_t axis, double value)
+        {
+            uint32_t bit = 1UL << axis;
+            if (pendingMask & bit)
+                numMerged++;
+            values[axis] = value;
+            pendingMask |= bit;
+            numPosted++;
+        }
+
+        /// @brief Called from the ISR. Returns true and clears the slot if a new value is waiting.
+        bool take(uint8_t axis, double &value)
+        {
+            uint32_t bit = 1UL << axis;
+            if (!(pendingMask & bit))
+                return false;
+            value = values[axis];
+            pendingMask &= ~bit;
+            return true;
+        }
+
+        void clear() { pendingMask = 0; numPosted = 0; numMerged = 0; }
+        bool anyPending() const { return pendingMask != 0; }
+        uint32_t posted() const { return numPosted; }
+        uint32_t merged() const { return numMerged; }
+
+    private:
+        static_assert(NUM_AXES <= 32, "pendingMask holds one bit per axis");
+        double values[NUM_AXES];
+        uint32_t pendingMask;
+        uint32_t numPosted;
+        uint32_t numMerged;
+    };
+};
+
+#endif
@@ -0,0 +1,139 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+///
+/// @brief Fixed-capacity, time-ordered queue for time-tagged commands
+/// @author Kevin Gilliam
+/// @date February 16th, 2023
+/// @file time_tagged_queue.h
+///
+
+#ifndef TIME_TAGGED_QUEUE_H
+#define TIME_TAGGED_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LFAST
+{
+    /// @brief Binary min-heap keyed on an execution time, with no dynamic allocation.
+    ///
+    /// T must have an int64_t member named execTimeNs. Entries with the same
+    /// execution time come back out in the order they were pushed. The queue is
+    /// not locked internally: if it is shared with an ISR, the non-ISR side has
+    /// to wrap its calls in noInterrupts()/interrupts().
+    template <typename T, std::size_t N>
+    class TimeTaggedQueue
+    {
+    public:
+        TimeTaggedQueue() : count(0), nextSeq(0) {}
+
+        std::size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        bool full() const { return count == N; }
+        static constexpr std::size_t capacity() { return N; }
+        void clear() { count = 0; }
+
+        /// @brief Adds an entry to the queue.
+        /// @return false if the queue is full and the entry was not added.
+        bool push(const T &item)
+        {
+            if (full())
+                return false;
+            std::size_t idx = count++;
+            heap[idx].item = item;
+            heap[idx].seq = nextSeq++;
+            siftUp(idx);
+            return true;
+        }
+
+        /// @brief Copies the earliest entry into out without removing it.
+        bool peek(T &out) const
+        {
+            if (empty())
+                return false;
+            out = heap[0].item;
+            return true;
+        }
+
+        /// @brief Removes the earliest entry if it is due at or before nowNs.
+        /// @return true if an entry was removed and copied into out.
+        bool popDue(int64_t nowNs, T &out)
+        {
+            if (empty() || heap[0].item.execTimeNs > nowNs)
+                return false;
+            out = heap[0].item;
+            heap[0] = heap[--count];
+            siftDown(0);
+            return true;
+        }
+
+    private:
+        struct Slot
+        {
+            T item;
+            uint32_t seq;
+        };
+
+        Slot heap[N];
+        std::size_t count;
+        uint32_t nextSeq;
+
+        bool earlier(const Slot &a, const Slot &b) const
+        {
+            if (a.item.execTimeNs != b.item.execTimeNs)
+                return a.item.execTimeNs < b.item.execTimeNs;
+            // Wrap-safe comparison so ties stay FIFO after the counter rolls over
+            return (int32_t)(a.seq - b.seq) < 0;
+        }
+
+        void siftUp(std::size_t idx)
+        {
+            while (idx > 0)
+            {
+                std::size_t parent = (idx - 1) / 2;
+                if (!earlier(heap[idx], heap[parent]))
+                    break;
+                swap(idx, parent);
+                idx = parent;
+            }
+        }
+
+        void siftDown(std::size_t idx)
+        {
+            while (true)
+            {
+                std::size_t left = 2 * idx + 1;
+                std::size_t right = left + 1;
+                std::size_t first = idx;
+                if (left < count && earlier(heap[left], heap[first]))
+                    first = left;
+                if (right < count && earlier(heap[right], heap[first]))
+                    first = right;
+                if (first == idx)
+                    break;
+                swap(idx, first);
+                idx = first;
+            }
+        }
+
+        void swap(std::size_t a, std::size_t b)
+        {
+            Slot tmp = heap[a];
+            heap[a] = heap[b];
+            heap[b] = tmp;
+        }
+    };
+};
+
+#endif
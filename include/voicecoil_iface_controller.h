@@ -19,8 +19,8 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 ///
 
 
-#ifndef DEVICE_CONTROLLER_H
-#define DEVICE_CONTROLLER_H
+#ifndef VOICECOIL_IFACE_CONTROLLER_H
+#define VOICECOIL_IFACE_CONTROLLER_H
 
 #include <Arduino.h>
 #include <LFAST_Device.h>
@@ -30,6 +30,9 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 
 #include <math_util.h>
 #include "teensy41_device.h"
+#include "PFC_config.h"
+#include "time_tagged_queue.h"
+#include "setpoint_coalescer.h"
 
 /// @brief  Use an enum to make it easy to switch the order that persistent fields are printed out.
 enum VC_CTRL_CLI_ROWS
@@ -41,11 +44,45 @@ enum VC_CTRL_CLI_ROWS
     // DEC_INFO,
     // CALLBACK_INFO_ROW,
     // BG_LOOP_INFO_ROW
+    EXEC_ERR_INFO_ROW,
+    CLOCK_SYNC_INFO_ROW
 };
 
 namespace LFAST
 {
-   
+    enum PFC_AXIS
+    {
+        TIP_AXIS,
+        TILT_AXIS,
+        FOCUS_AXIS,
+        NUM_PFC_AXES
+    };
+
+    /// @brief A setpoint change which takes effect at a given host time.
+    struct TimedCommand
+    {
+        int64_t execTimeNs;
+        uint8_t axis;
+        double value;
+    };
+
+    /// @brief Achieved execution time error (actual minus requested) of timed commands.
+    struct ExecTimingStats
+    {
+        int64_t lastErrNs;
+        int64_t maxAbsErrNs;
+        double meanAbsErrNs;
+        uint32_t numExecuted;
+        uint32_t numRejected;
+    };
+
+    /// @brief Counters for the immediate (untimed) setpoint path.
+    struct SetpointStats
+    {
+        uint32_t numPosted;
+        uint32_t numMerged;
+        uint32_t numApplied;
+    };
 };
 
 /// @brief Rename the VoiceCoilInterfaceController class when creating a new controller from this template.
@@ -63,8 +100,26 @@ public:
     void doNonInterruptStuff();
 
     void doSomethingForACallback();
+
+    void setSetpoint(uint8_t axis, double value);
+    bool scheduleSetpoint(uint8_t axis, double value, int64_t execTimeNs);
+    double getSetpoint(uint8_t axis) const;
+    LFAST::ExecTimingStats getExecTimingStats() const;
+    LFAST::SetpointStats getSetpointStats() const;
+    std::size_t pendingCommands() const { return cmdQueue.size(); }
+    void clearPendingCommands();
+    void reset();
+
 private:
-    VoiceCoilInterfaceController(){};
+    VoiceCoilInterfaceController();
+
+    void recordExecError(int64_t errNs);
+
+    volatile double setpoints[LFAST::NUM_PFC_AXES];
+    LFAST::TimeTaggedQueue<LFAST::TimedCommand, TIMED_CMD_QUEUE_DEPTH> cmdQueue;
+    LFAST::ExecTimingStats execStats;
+    LFAST::SetpointCoalescer<LFAST::NUM_PFC_AXES> coalescer;
+    uint32_t numApplied;
 
 };
 
@@ -29,6 +29,7 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 #include "PFC_config.h"
 #include "teensy41_device.h"
 #include "TimerOne.h"
+#include "health_monitor.h"
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////// Control Functions  //////////////////////////////////////
@@ -49,6 +50,11 @@ ADCController &ADCController::getDeviceController()
     return instance;
 }
 
+ADCController::ADCController()
+    : lastWiperSampleUs(0), lastWiper(0), haveWiperSample(false)
+{
+}
+
 /// @brief Any code which leverages hardware on the Teensy (such as timers, interrupts, etc)
 void ADCController::hardware_setup()
 {
@@ -63,6 +69,29 @@ void ADCController::doNonInterruptStuff()
 {
     static uint64_t bg_loop_ct = 0;
     // cli->updatePersistentField(DeviceName, BG_LOOP_INFO_ROW, bg_loop_ct++, "%d");
+
+    if (!haveWiperSample || micros() - lastWiperSampleUs >= HEALTH_WIPER_SAMPLE_PRD_US)
+        sampleWiper();
+}
+
+/// @brief Reads the position wiper and feeds the health statistics.
+///
+/// The sample-to-sample change goes to its own channel so that a noisy pot
+/// shows up even while the motor is moving.
+void ADCController::sampleWiper()
+{
+    int wiper = analogRead(ADC_POSN_WIPER_PIN);
+    HealthMonitor &health = HealthMonitor::getMonitor();
+    // The control ISR also updates the monitor's shared event counters
+    noInterrupts();
+    health.update(WIPER_POSN_CH, wiper);
+    if (haveWiperSample)
+        health.update(WIPER_NOISE_CH, wiper - lastWiper);
+    interrupts();
+
+    lastWiper = wiper;
+    lastWiperSampleUs = micros();
+    haveWiperSample = true;
 }
 
 /// @brief Creates persistent field labels for the terminal interface.
@@ -0,0 +1,118 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+///
+/// @brief Disciplines the local timestamp counter against a host time reference
+/// @author Kevin Gilliam
+/// @date February 16th, 2023
+/// @file clock_discipline.cpp
+///
+
+#include "clock_discipline.h"
+#include <cmath>
+#include <cstdlib>
+#include "PFC_config.h"
+
+using namespace LFAST;
+
+ClockDiscipline::ClockDiscipline()
+    : kp(CLOCK_SYNC_KP),
+      ki(CLOCK_SYNC_KI),
+      maxDelayNs(CLOCK_SYNC_MAX_RTT_NS),
+      stepThresholdNs(CLOCK_SYNC_STEP_NS)
+{
+    reset();
+}
+
+/// @brief Forgets the current offset/rate estimate and the sample counters.
+void ClockDiscipline::reset()
+{
+    synced = false;
+    refLocalNs = 0;
+    refOffsetNs = 0;
+    rate = 0.0;
+    lastErrorNs = 0;
+    lastDelayNs = 0;
+    numAccepted = 0;
+    numRejected = 0;
+}
+
+void ClockDiscipline::setGains(double kp_, double ki_)
+{
+    kp = kp_;
+    ki = ki_;
+}
+
+int64_t ClockDiscipline::offsetAt(int64_t localNs) const
+{
+    return refOffsetNs + (int64_t)std::llround(rate * (double)(localNs - refLocalNs));
+}
+
+int64_t ClockDiscipline::toHostNs(int64_t localNs) const
+{
+    return localNs + offsetAt(localNs);
+}
+
+int64_t ClockDiscipline::toLocalNs(int64_t hostNs) const
+{
+    // The rate is a few ppm at most, so evaluating the offset at the host time
+    // instead of the (unknown) local time is off by well under a nanosecond.
+    return hostNs - offsetAt(hostNs - refOffsetNs);
+}
+
+bool ClockDiscipline::addSample(const SyncSample &s)
+{
+    int64_t delay = (s.t4_hostRx - s.t1_hostTx) - (s.t3_localTx - s.t2_localRx);
+    if (delay < 0 || delay > maxDelayNs)
+    {
+        numRejected++;
+        return false;
+    }
+    lastDelayNs = delay;
+
+    // Host-minus-local offset at the midpoint of the local turnaround
+    int64_t measOffset = ((s.t1_hostTx - s.t2_localRx) + (s.t4_hostRx - s.t3_localTx)) / 2;
+    int64_t localMid = s.t2_localRx + (s.t3_localTx - s.t2_localRx) / 2;
+
+    if (!synced)
+    {
+        refLocalNs = localMid;
+        refOffsetNs = measOffset;
+        rate = 0.0;
+        lastErrorNs = 0;
+        synced = true;
+        numAccepted++;
+        return true;
+    }
+
+    int64_t predicted = offsetAt(localMid);
+    int64_t err = measOffset - predicted;
+    lastErrorNs = err;
+
+    if (std::llabs(err) > stepThresholdNs)
+    {
+        refLocalNs = localMid;
+        refOffsetNs = measOffset;
+        rate = 0.0;
+    }
+    else
+    {
+        double dt = (double)(localMid - refLocalNs);
+        if (dt > 0.0)
+            rate += ki * (double)err / dt;
+        refOffsetNs = predicted + (int64_t)std::llround(kp * (double)err);
+        refLocalNs = localMid;
+    }
+    numAccepted++;
+    return true;
+}
@@ -0,0 +1,182 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+///
+/// @brief Stages setpoint commands from one TCP message and dispatches them together
+/// @author Kevin Gilliam
+/// @date February 16th, 2023
+/// @file command_dispatcher.cpp
+///
+
+#include "command_dispatcher.h"
+#include <cstdio>
+#include "ptp_clock.h"
+#include "health_monitor.h"
+
+using namespace LFAST;
+
+CommandDispatcher::CommandDispatcher(VoiceCoilInterfaceController &vc_)
+    : vc(vc_), numSetpointsReceived(0), numSetpointsMerged(0), numSetpointsDropped(0)
+{
+    beginMessage();
+}
+
+/// @brief Clears the staged values. Call before processing each controller message.
+void CommandDispatcher::beginMessage()
+{
+    staged = {};
+}
+
+/// @brief Tags the setpoints in this message with a host execution time.
+void CommandDispatcher::setExecTime(int64_t hostNs)
+{
+    staged.hasExecTime = true;
+    staged.execTimeNs = hostNs;
+}
+
+void CommandDispatcher::stageSetpoint(uint8_t axis, double value)
+{
+    if (axis >= NUM_PFC_AXES)
+        return;
+    numSetpointsReceived++;
+    // A repeated key within one message replaces the earlier value
+    if (staged.hasSetpoint[axis])
+        numSetpointsMerged++;
+    staged.hasSetpoint[axis] = true;
+    staged.setpoint[axis] = value;
+}
+
+/// @brief Sets the global limit on setpoint messages per second (<= 0 disables).
+void CommandDispatcher::stageRateLimit(double cmdsPerSec)
+{
+    staged.hasRateLimit = true;
+    staged.rateLimit = cmdsPerSec;
+}
+
+/// @brief Sets how many setpoint messages may burst above the global rate.
+void CommandDispatcher::stageRateBurst(double cmds)
+{
+    staged.hasRateBurst = true;
+    staged.rateBurst = cmds;
+}
+
+/// @brief Selects the health channel whose thresholds this message changes.
+void CommandDispatcher::stageHealthChannel(unsigned int channel)
+{
+    staged.hasHealthChannel = true;
+    staged.healthChannel = channel;
+}
+
+void CommandDispatcher::stageHealthMaxNoise(double limit)
+{
+    staged.hasHealthMaxNoise = true;
+    staged.healthMaxNoise = limit;
+}
+
+void CommandDispatcher::stageHealthMaxDrift(double limit)
+{
+    staged.hasHealthMaxDrift = true;
+    staged.healthMaxDrift = limit;
+}
+
+void CommandDispatcher::stageHealthMaxRms(double limit)
+{
+    staged.hasHealthMaxRms = true;
+    staged.healthMaxRms = limit;
+}
+
+/// @brief Changes the staged limits of the staged health channel; the others are kept.
+void CommandDispatcher::applyHealthThresholds()
+{
+    if (!staged.hasHealthChannel || staged.healthChannel >= NUM_HEALTH_CHANNELS)
+        return;
+    if (!staged.hasHealthMaxNoise && !staged.hasHealthMaxDrift && !staged.hasHealthMaxRms)
+        return;
+
+    HEALTH_CHANNEL ch = (HEALTH_CHANNEL)staged.healthChannel;
+    HealthMonitor &health = HealthMonitor::getMonitor();
+    // The control ISR reads the thresholds in update()
+    noInterrupts();
+    HealthThresholds th = health.getThresholds(ch);
+    if (staged.hasHealthMaxNoise)
+        th.maxStdDev = staged.healthMaxNoise;
+    if (staged.hasHealthMaxDrift)
+        th.maxDrift = staged.healthMaxDrift;
+    if (staged.hasHealthMaxRms)
+        th.maxRms = staged.healthMaxRms;
+    health.setThresholds(ch, th);
+    interrupts();
+}
+
+/// @brief Applies or queues everything staged since beginMessage().
+void CommandDispatcher::dispatch()
+{
+    applyHealthThresholds();
+
+    if (staged.hasRateLimit || staged.hasRateBurst)
+    {
+        setpointRateLimit.configure(staged.hasRateLimit ? staged.rateLimit : setpointRateLimit.getRate(),
+                                    staged.hasRateBurst ? staged.rateBurst : setpointRateLimit.getBurst());
+    }
+
+    uint8_t numStaged = 0;
+    for (uint8_t axis = 0; axis < NUM_PFC_AXES; axis++)
+        numStaged += staged.hasSetpoint[axis] ? 1 : 0;
+    if (numStaged == 0)
+        return;
+
+    if (!setpointRateLimit.tryConsume(PtpClock::getClock().localNowNs()))
+    {
+        numSetpointsDropped += numStaged;
+        return;
+    }
+
+    for (uint8_t axis = 0; axis < NUM_PFC_AXES; axis++)
+    {
+        if (!staged.hasSetpoint[axis])
+            continue;
+        if (!staged.hasExecTime)
+            vc.setSetpoint(axis, staged.setpoint[axis]);
+        else if (!vc.scheduleSetpoint(axis, staged.setpoint[axis], staged.execTimeNs))
+            numSetpointsDropped++;
+    }
+}
+
+std::size_t formatTelemetryFrame(char *buf, std::size_t len,
+                                 VoiceCoilInterfaceController &vc,
+                                 const CommandDispatcher &dispatcher)
+{
+    ExecTimingStats stats = vc.getExecTimingStats();
+    SetpointStats spStats = vc.getSetpointStats();
+    PtpClock &clock = PtpClock::getClock();
+    const ClockDiscipline &clk = clock.getDiscipline();
+
+    int n = snprintf(buf, len,
+                     "{\"Telemetry\":{\"HostTime\":%.6f,\"SetTip\":%g,\"SetTilt\":%g,\"SetFocus\":%g,"
+                     "\"ClockSynced\":%u,\"ClockOffsetErr\":%g,\"ExecErrMax\":%g,\"ExecErrMean\":%g,"
+                     "\"ExecCount\":%lu,\"CmdMerged\":%lu,\"CmdDropped\":%lu}}",
+                     (double)clock.hostNowNs() * 1.0e-9,
+                     vc.getSetpoint(TIP_AXIS),
+                     vc.getSetpoint(TILT_AXIS),
+                     vc.getSetpoint(FOCUS_AXIS),
+                     clk.isSynchronized() ? 1u : 0u,
+                     (double)clk.lastOffsetErrorNs() * 1.0e-9,
+                     (double)stats.maxAbsErrNs * 1.0e-9,
+                     stats.meanAbsErrNs * 1.0e-9,
+                     (unsigned long)stats.numExecuted,
+                     (unsigned long)(spStats.numMerged + dispatcher.mergedSetpoints()),
+                     (unsigned long)dispatcher.droppedSetpoints());
+    if (n < 0 || (std::size_t)n >= len)
+        return 0;
+    return (std::size_t)n;
+}
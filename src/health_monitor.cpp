@@ -0,0 +1,236 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+///
+/// @brief Streaming, constant-memory health statistics for sensors and actuators
+/// @author Kevin Gilliam
+/// @date February 16th, 2023
+/// @file health_monitor.cpp
+///
+
+#include "health_monitor.h"
+#include <cmath>
+#include <cstdio>
+#include "PFC_config.h"
+
+using namespace LFAST;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////// ChannelStats  ///////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+ChannelStats::ChannelStats()
+{
+    reset();
+}
+
+void ChannelStats::reset()
+{
+    n = 0;
+    runningMean = 0.0;
+    m2 = 0.0;
+    minValue = 0.0;
+    maxValue = 0.0;
+    ewFast = 0.0;
+    ewSlow = 0.0;
+    ewSquare = 0.0;
+}
+
+/// @brief Adds one sample. Constant time and memory, no square roots.
+void ChannelStats::update(double x)
+{
+    if (n == 0)
+    {
+        minValue = maxValue = x;
+        ewFast = ewSlow = x;
+        ewSquare = x * x;
+    }
+    else
+    {
+        if (x < minValue)
+            minValue = x;
+        if (x > maxValue)
+            maxValue = x;
+        ewFast += HEALTH_EW_FAST_ALPHA * (x - ewFast);
+        ewSlow += HEALTH_EW_SLOW_ALPHA * (x - ewSlow);
+        ewSquare += HEALTH_EW_FAST_ALPHA * (x * x - ewSquare);
+    }
+
+    n++;
+    double delta = x - runningMean;
+    runningMean += delta / (double)n;
+    m2 += delta * (x - runningMean);
+}
+
+double ChannelStats::stdDev() const
+{
+    return std::sqrt(variance());
+}
+
+double ChannelStats::rms() const
+{
+    return std::sqrt(ewSquare);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////// HealthMonitor  //////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Returns a reference to the singleton instantiation of this class
+HealthMonitor &HealthMonitor::getMonitor()
+{
+    static HealthMonitor instance;
+    return instance;
+}
+
+HealthMonitor::HealthMonitor()
+{
+    reset();
+}
+
+/// @brief Clears every channel's statistics, flags and the event counters, and
+/// restores the default thresholds from PFC_config.h.
+void HealthMonitor::reset()
+{
+    for (int ii = 0; ii < NUM_HEALTH_CHANNELS; ii++)
+        thresholds[ii] = {};
+    thresholds[WIPER_POSN_CH] = {0.0, HEALTH_WIPER_MAX_DRIFT, 0.0, 0.0, 0.0};
+    thresholds[WIPER_NOISE_CH] = {0.0, 0.0, HEALTH_WIPER_MAX_NOISE, 0.0, 0.0};
+    thresholds[EXEC_TIME_CH] = {0.0, HEALTH_EXEC_MAX_DRIFT_NS, HEALTH_EXEC_MAX_RMS_NS, 0.0, 0.0};
+    thresholds[CLOCK_OFFSET_CH] = {0.0, HEALTH_CLOCK_MAX_DRIFT_NS, HEALTH_CLOCK_MAX_RMS_NS, 0.0, 0.0};
+
+    for (int ii = 0; ii < NUM_HEALTH_CHANNELS; ii++)
+    {
+        stats[ii].reset();
+        channelFlags[ii] = HEALTH_OK;
+    }
+    numEvents = 0;
+    newEventMask = 0;
+}
+
+void HealthMonitor::setThresholds(HEALTH_CHANNEL ch, const HealthThresholds &th)
+{
+    if (ch < NUM_HEALTH_CHANNELS)
+        thresholds[ch] = th;
+}
+
+HealthThresholds HealthMonitor::getThresholds(HEALTH_CHANNEL ch) const
+{
+    if (ch >= NUM_HEALTH_CHANNELS)
+        return HealthThresholds{};
+    return thresholds[ch];
+}
+
+/// @brief Adds a sample to a channel and raises an event for any newly exceeded threshold.
+void HealthMonitor::update(HEALTH_CHANNEL ch, double x)
+{
+    if (ch >= NUM_HEALTH_CHANNELS)
+        return;
+    ChannelStats &s = stats[ch];
+    const HealthThresholds &th = thresholds[ch];
+    s.update(x);
+
+    uint8_t raised = HEALTH_OK;
+    if (th.minValue != th.maxValue && (x < th.minValue || x > th.maxValue))
+        raised |= HEALTH_RANGE;
+    if (s.count() >= HEALTH_MIN_SAMPLES)
+    {
+        // Compare squares to keep sqrt out of the update path
+        if (th.maxStdDev > 0.0 && s.variance() > th.maxStdDev * th.maxStdDev)
+            raised |= HEALTH_NOISE;
+        if (th.maxDrift > 0.0 && std::fabs(s.trend()) > th.maxDrift)
+            raised |= HEALTH_DRIFT;
+        if (th.maxRms > 0.0 && s.meanSquare() > th.maxRms * th.maxRms)
+            raised |= HEALTH_RMS;
+    }
+
+    if (raised & ~channelFlags[ch])
+    {
+        numEvents++;
+        newEventMask |= 1UL << ch;
+        channelFlags[ch] |= raised;
+    }
+}
+
+/// @brief Un-latches every channel's flags. The statistics are kept.
+void HealthMonitor::clearFlags()
+{
+    for (int ii = 0; ii < NUM_HEALTH_CHANNELS; ii++)
+        channelFlags[ii] = HEALTH_OK;
+    newEventMask = 0;
+}
+
+uint8_t HealthMonitor::allFlags() const
+{
+    uint8_t all = HEALTH_OK;
+    for (int ii = 0; ii < NUM_HEALTH_CHANNELS; ii++)
+        all |= channelFlags[ii];
+    return all;
+}
+
+/// @brief Returns a bit per channel which raised an event since the last call.
+uint32_t HealthMonitor::takeNewEvents()
+{
+    uint32_t mask = newEventMask;
+    newEventMask = 0;
+    return mask;
+}
+
+HealthSnapshot HealthMonitor::snapshot() const
+{
+    HealthSnapshot snap;
+    for (int ii = 0; ii < NUM_HEALTH_CHANNELS; ii++)
+    {
+        snap.channels[ii] = stats[ii];
+        snap.flags[ii] = channelFlags[ii];
+    }
+    snap.numEvents = numEvents;
+    return snap;
+}
+
+const char *HealthMonitor::channelName(HEALTH_CHANNEL ch)
+{
+    switch (ch)
+    {
+    case WIPER_POSN_CH:
+        return "WiperPosn";
+    case WIPER_NOISE_CH:
+        return "WiperNoise";
+    case EXEC_TIME_CH:
+        return "ExecTime";
+    case CLOCK_OFFSET_CH:
+        return "ClockOffset";
+    default:
+        return "Unknown";
+    }
+}
+
+/// Each channel is an array in the order given by "Fields".
+std::size_t LFAST::formatHealthSummary(char *buf, std::size_t len, const HealthSnapshot &snap)
+{
+    int n = snprintf(buf, len, "{\"Health\":{\"Events\":%lu,\"Fields\":\"n,mean,std,min,max,trend,rms,flags\"",
+                     (unsigned long)snap.numEvents);
+    for (int ii = 0; ii < NUM_HEALTH_CHANNELS && n > 0 && (std::size_t)n < len; ii++)
+    {
+        const ChannelStats &s = snap.channels[ii];
+        n += snprintf(buf + n, len - n, ",\"%s\":[%lu,%.5g,%.4g,%.5g,%.5g,%.4g,%.4g,%u]",
+                      HealthMonitor::channelName((HEALTH_CHANNEL)ii),
+                      (unsigned long)s.count(), s.mean(), s.stdDev(), s.min(), s.max(),
+                      s.trend(), s.rms(), (unsigned int)snap.flags[ii]);
+    }
+    if (n > 0 && (std::size_t)n < len)
+        n += snprintf(buf + n, len - n, "}}");
+    if (n < 0 || (std::size_t)n >= len)
+        return 0;
+    return (std::size_t)n;
+}
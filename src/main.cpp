@@ -31,35 +31,71 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 #include <math.h>
 #include <string>
 
-#include <TcpCommsService.h>
 #include <TerminalInterface.h>
 #include <teensy41_device.h>
 
 #include "PFC_config.h"
 #include "adc_controller.h"
+#include "voicecoil_iface_controller.h"
+#include "ptp_clock.h"
+#include "command_dispatcher.h"
+#include "session_server.h"
+#include "message_router.h"
+#include "health_monitor.h"
 
-/// @brief Pointers to the two LFAST_Device objects being used here
-LFAST::TcpCommsService *commsService;
+/// @brief Pointers to the LFAST_Device objects being used here
+///
+/// sessionServer owns both ports: the single controller session on PORT, whose
+/// messages go to router, and read-only telemetry subscribers on
+/// TELEMETRY_PORT. Replies are sent to the controller session only.
+SessionServer *sessionServer;
+MessageRouter *router;
 TerminalInterface *cli;
 
 /// @brief Pointer to the controller which is specific to this application.
 ADCController *pDC;
+VoiceCoilInterfaceController *pVC;
+CommandDispatcher *dispatcher;
 
 
 ///////////////////////////////////////////////////////////////////////////
-/// The LFAST Comms library (of which TcpCommsService is a component)
-/// works by associating JSON key-value pairs to function pointers.
-/// When a key is received, the library checks to see if a function 
+/// The MessageRouter works by associating JSON key-value pairs to function
+/// pointers. When a key is received, the router checks to see if a function
 /// pointer has been registered for it. If it has, it calls that function
 /// and passes the value from the key-value pair as an argument.
-/// This template defines and registers two such callbacks in this file.
+/// The keys of one message are staged in the dispatcher by these callbacks
+/// and applied together once the whole message has been read.
 ///////////////////////////////////////////////////////////////////////////
 void handshake(unsigned int val);
 void otherCallback(double some_value);
+void execTimeCallback(double host_sec);
+void setTipCallback(double val);
+void setTiltCallback(double val);
+void setFocusCallback(double val);
+void syncT1Callback(double host_sec);
+void syncT4Callback(double host_sec);
+void getTelemetryCallback(unsigned int val);
+void setRateLimitCallback(double cmds_per_sec);
+void setRateBurstCallback(double cmds);
+std::size_t buildTelemetryFrame(char *buf, std::size_t len);
+void getHealthCallback(unsigned int val);
+void clearHealthCallback(unsigned int val);
+void healthChannelCallback(unsigned int channel);
+void setHealthMaxNoiseCallback(double limit);
+void setHealthMaxDriftCallback(double limit);
+void setHealthMaxRmsCallback(double limit);
+std::size_t buildHealthSummary(char *buf, std::size_t len);
+void reportHealthEvents();
+void beginCommandMessage();
+void dispatchCommandMessage();
+void sendReply(LFAST::ReplyMessage &msg);
+
+static int64_t secToNs(double sec) { return (int64_t)llround(sec * 1.0e9); }
+static double nsToSec(int64_t ns) { return (double)ns * 1.0e-9; }
 
 /// @brief variables for the TCP configuration
 byte myIP[] IP_ADDR;
-unsigned int myPort = PORT;
+byte myMAC[] MAC;
 
 /// @brief Function is called by the Arduino framework before the main loop starts
 void setup()
@@ -67,14 +103,20 @@ void setup()
   // The terminal interface uses a teensy serial port to display data and report
   // messages in an organized way. 
   cli = new TerminalInterface(DEVICE_CLI_LABEL, &(TEST_SERIAL), TEST_SERIAL_BAUD);
-  commsService = new LFAST::TcpCommsService(myIP);
-  // Any classes derived from LFAST_Device (such as TcpCommsService) can print
+  sessionServer = new SessionServer(PORT, TELEMETRY_PORT);
+  // Any classes derived from LFAST_Device (such as SessionServer) can print
   // data out to the same terminal interface, they don't all need their own.
   // They just have to be given a pointer to the terminal object:
-  commsService->connectTerminalInterface(cli, "Comms");
-  // It is helpful to connect the terminal before calling the TcpCommsService's
-  // Initialization function so that any error messages can be printed out.
-  commsService->initializeEnetIface(PORT);
+  sessionServer->connectTerminalInterface(cli, "Sessions");
+  // It is helpful to connect the terminal before initializing the Ethernet
+  // interface so that any error messages can be printed out.
+  bool enetOk = sessionServer->initializeEnetIface(myMAC, myIP);
+
+  router = new MessageRouter("DeviceFilterStr");
+  router->setMessageHooks(beginCommandMessage, dispatchCommandMessage);
+  sessionServer->setControllerRouter(router);
+  sessionServer->setTelemetrySource(buildTelemetryFrame);
+  sessionServer->setHealthSource(buildHealthSummary);
 
   // The PFCController class is a singleton, (meaning only one can exist), so 
   // instead of creating one with the new keyword, we use its getDeviceController
@@ -83,13 +125,22 @@ void setup()
   pDC = &dc;
   pDC->connectTerminalInterface(cli, "Device");
 
+  VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+  pVC = &vc;
+  pVC->connectTerminalInterface(cli, "VoiceCoil");
+  pVC->hardware_setup();
+  dispatcher = new CommandDispatcher(vc);
+
+  // The 1588 timer lives in the ENET peripheral, so start it after the interface is up.
+  PtpClock::getClock().hardware_setup();
+
   // The terminal's persistent fields are set up to print out values which update 
   // frequently to the same position in the console window, rather than printing out
   // an endlessly scrolling list of values.
   cli->printPersistentFieldLabels();
 
-  // The CommsService library will tell you if there was a problem starting up.
-  if (!commsService->Status())
+  // The session server will tell you if there was a problem starting up.
+  if (!enetOk)
   {
     cli->printDebugMessage("Device Setup Failed.");
     while (true)
@@ -99,8 +150,23 @@ void setup()
   }
 
   // Registering the message handlers as described above.
-  commsService->registerMessageHandler<unsigned int>("Handshake", handshake);
-  commsService->registerMessageHandler<double>("Other_Callback", otherCallback);
+  router->registerMessageHandler<unsigned int>("Handshake", handshake);
+  router->registerMessageHandler<double>("Other_Callback", otherCallback);
+  router->registerMessageHandler<double>("ExecTime", execTimeCallback);
+  router->registerMessageHandler<double>("SetTip", setTipCallback);
+  router->registerMessageHandler<double>("SetTilt", setTiltCallback);
+  router->registerMessageHandler<double>("SetFocus", setFocusCallback);
+  router->registerMessageHandler<double>("SyncT1", syncT1Callback);
+  router->registerMessageHandler<double>("SyncT4", syncT4Callback);
+  router->registerMessageHandler<unsigned int>("GetTelemetry", getTelemetryCallback);
+  router->registerMessageHandler<double>("SetRateLimit", setRateLimitCallback);
+  router->registerMessageHandler<double>("SetRateBurst", setRateBurstCallback);
+  router->registerMessageHandler<unsigned int>("GetHealth", getHealthCallback);
+  router->registerMessageHandler<unsigned int>("ClearHealth", clearHealthCallback);
+  router->registerMessageHandler<unsigned int>("HealthChannel", healthChannelCallback);
+  router->registerMessageHandler<double>("SetHealthMaxNoise", setHealthMaxNoiseCallback);
+  router->registerMessageHandler<double>("SetHealthMaxDrift", setHealthMaxDriftCallback);
+  router->registerMessageHandler<double>("SetHealthMaxRms", setHealthMaxRmsCallback);
 
   delay(500);
 
@@ -130,15 +196,16 @@ void loop()
   feedWatchDog();
 #endif
 
-  commsService->checkForNewClients();
-  if (commsService->checkForNewClientData())
-  {
-    commsService->processClientData("DeviceFilterStr");
-  }
-  commsService->stopDisconnectedClients();
+  // Keeps the 1588 timer's software seconds count current when the control ISR is not running
+  PtpClock::getClock().localNowNs();
+
+  // Each complete controller message is routed and dispatched on its own
+  sessionServer->service();
 
   // Loop code for updating the controller device
   pDC->doNonInterruptStuff();
+  pVC->doNonInterruptStuff();
+  reportHealthEvents();
 }
 
 /// @brief Handshake function to confirm connection
@@ -147,11 +214,11 @@ void handshake(unsigned int val)
 {
   if (val == 0xDEAD)
   {
-    LFAST::CommsMessage newMsg;
+    LFAST::ReplyMessage newMsg;
     newMsg.addKeyValuePair<unsigned int>("Handshake", 0xBEEF);
-    commsService->sendMessage(newMsg, LFAST::CommsService::ACTIVE_CONNECTION);
+    sendReply(newMsg);
     cli->printDebugMessage("Connected to client, starting control ISR.");
-    // pDC->enableControlInterrupt();
+    pVC->enableControlInterrupt();
   }
   return;
 }
@@ -167,4 +234,204 @@ void otherCallback(double some_value)
   interrupts();
 }
 
+/// @brief Tags the setpoints in this message with a host execution time.
+/// @param host_sec Execution time on the host time reference, in seconds
+void execTimeCallback(double host_sec)
+{
+  dispatcher->setExecTime(secToNs(host_sec));
+}
+
+void setTipCallback(double val)
+{
+  dispatcher->stageSetpoint(LFAST::TIP_AXIS, val);
+}
+
+void setTiltCallback(double val)
+{
+  dispatcher->stageSetpoint(LFAST::TILT_AXIS, val);
+}
+
+void setFocusCallback(double val)
+{
+  dispatcher->stageSetpoint(LFAST::FOCUS_AXIS, val);
+}
+
+/// @brief Sets the global limit on setpoint messages per second (<= 0 disables).
+void setRateLimitCallback(double cmds_per_sec)
+{
+  dispatcher->stageRateLimit(cmds_per_sec);
+}
+
+/// @brief Sets how many setpoint messages may burst above the global rate.
+void setRateBurstCallback(double cmds)
+{
+  dispatcher->stageRateBurst(cmds);
+}
+
+/// @brief First half of a clock sync exchange with the host time reference.
+///
+/// Replies with the local receive (t2) and transmit (t3) times so the host
+/// can close the exchange with SyncT4. Both are read from the 1588 timer in
+/// software here rather than from the ENET packet descriptors, so the time the
+/// request waited in the stack and the reply waits in the transmit ring shows
+/// up as offset jitter (see interface.md).
+/// @param host_sec Host time when the request was sent (t1), in seconds
+void syncT1Callback(double host_sec)
+{
+  PtpClock &clk = PtpClock::getClock();
+  int64_t t2 = clk.stampSyncRequest(secToNs(host_sec));
+  LFAST::ReplyMessage newMsg;
+  newMsg.addKeyValuePair<double>("SyncT2", nsToSec(t2));
+  newMsg.addKeyValuePair<double>("SyncT3", nsToSec(clk.stampSyncReply()));
+  sendReply(newMsg);
+}
+
+/// @brief Second half of a clock sync exchange.
+/// @param host_sec Host time when the SyncT1 reply was received (t4), in seconds
+void syncT4Callback(double host_sec)
+{
+  // The control ISR reads the discipline state, so update it atomically
+  noInterrupts();
+  bool accepted = PtpClock::getClock().completeSync(secToNs(host_sec));
+  if (accepted)
+    HealthMonitor::getMonitor().update(LFAST::CLOCK_OFFSET_CH,
+                                       PtpClock::getClock().getDiscipline().lastOffsetErrorNs());
+  interrupts();
+  if (!accepted)
+    cli->printDebugMessage("Clock sync sample rejected.");
+}
+
+/// @brief Replies with timing telemetry (all times in seconds).
+void getTelemetryCallback(unsigned int val)
+{
+  LFAST::ExecTimingStats stats = pVC->getExecTimingStats();
+  const LFAST::ClockDiscipline &clk = PtpClock::getClock().getDiscipline();
+
+  LFAST::ReplyMessage newMsg;
+  newMsg.addKeyValuePair<double>("HostTime", nsToSec(PtpClock::getClock().hostNowNs()));
+  newMsg.addKeyValuePair<unsigned int>("ClockSynced", clk.isSynchronized() ? 1 : 0);
+  newMsg.addKeyValuePair<double>("ClockOffsetErr", nsToSec(clk.lastOffsetErrorNs()));
+  newMsg.addKeyValuePair<double>("ClockRoundTrip", nsToSec(clk.lastRoundTripNs()));
+  newMsg.addKeyValuePair<double>("ClockRatePpb", clk.rateCorrectionPpb());
+  newMsg.addKeyValuePair<double>("ExecErrLast", nsToSec(stats.lastErrNs));
+  newMsg.addKeyValuePair<double>("ExecErrMax", nsToSec(stats.maxAbsErrNs));
+  newMsg.addKeyValuePair<double>("ExecErrMean", stats.meanAbsErrNs * 1.0e-9);
+  newMsg.addKeyValuePair<unsigned int>("ExecCount", stats.numExecuted);
+  newMsg.addKeyValuePair<unsigned int>("ExecRejected", stats.numRejected);
+  newMsg.addKeyValuePair<unsigned int>("ExecPending", (unsigned int)pVC->pendingCommands());
+
+  LFAST::SetpointStats spStats = pVC->getSetpointStats();
+  newMsg.addKeyValuePair<unsigned int>("CmdReceived", dispatcher->receivedSetpoints());
+  newMsg.addKeyValuePair<unsigned int>("CmdPosted", spStats.numPosted);
+  newMsg.addKeyValuePair<unsigned int>("CmdMerged", spStats.numMerged + dispatcher->mergedSetpoints());
+  newMsg.addKeyValuePair<unsigned int>("CmdApplied", spStats.numApplied);
+  newMsg.addKeyValuePair<unsigned int>("CmdRateLimited", dispatcher->getSetpointRateLimit().dropped());
+  newMsg.addKeyValuePair<unsigned int>("CmdDropped", dispatcher->droppedSetpoints());
+  newMsg.addKeyValuePair<unsigned int>("TelemetrySessions", sessionServer->activeSessions());
+  sendReply(newMsg);
+}
+
+/// @brief Replies with the latched health flags and event count.
+///
+/// The full per-channel summary is large, so it is served to telemetry
+/// sessions ({"GetHealth": 0} on TELEMETRY_PORT) rather than through here.
+void getHealthCallback(unsigned int val)
+{
+  noInterrupts();
+  unsigned int flags = HealthMonitor::getMonitor().allFlags();
+  unsigned int events = HealthMonitor::getMonitor().events();
+  interrupts();
+
+  LFAST::ReplyMessage newMsg;
+  newMsg.addKeyValuePair<unsigned int>("HealthFlags", flags);
+  newMsg.addKeyValuePair<unsigned int>("HealthEvents", events);
+  sendReply(newMsg);
+}
+
+/// @brief Un-latches the health flags so new events can be raised.
+void clearHealthCallback(unsigned int val)
+{
+  noInterrupts();
+  HealthMonitor::getMonitor().clearFlags();
+  interrupts();
+}
+
+/// @brief Selects the health channel whose thresholds the SetHealthMax* keys in this message change.
+void healthChannelCallback(unsigned int channel)
+{
+  dispatcher->stageHealthChannel(channel);
+}
+
+/// @brief Standard deviation limit for the selected health channel (0 disables).
+void setHealthMaxNoiseCallback(double limit)
+{
+  dispatcher->stageHealthMaxNoise(limit);
+}
+
+/// @brief Trend (fast minus slow average) limit for the selected health channel (0 disables).
+void setHealthMaxDriftCallback(double limit)
+{
+  dispatcher->stageHealthMaxDrift(limit);
+}
+
+/// @brief RMS limit for the selected health channel (0 disables).
+void setHealthMaxRmsCallback(double limit)
+{
+  dispatcher->stageHealthMaxRms(limit);
+}
+
+/// @brief Health summary source for the session server.
+std::size_t buildHealthSummary(char *buf, std::size_t len)
+{
+  noInterrupts();
+  LFAST::HealthSnapshot snap = HealthMonitor::getMonitor().snapshot();
+  interrupts();
+  return LFAST::formatHealthSummary(buf, len, snap);
+}
+
+/// @brief Prints a debug message for every channel which raised a new health event.
+void reportHealthEvents()
+{
+  noInterrupts();
+  uint32_t newEvents = HealthMonitor::getMonitor().takeNewEvents();
+  interrupts();
+
+  for (int ch = 0; newEvents != 0 && ch < LFAST::NUM_HEALTH_CHANNELS; ch++)
+  {
+    if (newEvents & (1UL << ch))
+    {
+      std::string msg = "Health event on ";
+      msg += HealthMonitor::channelName((LFAST::HEALTH_CHANNEL)ch);
+      cli->printDebugMessage(msg);
+    }
+  }
+}
+
+/// @brief Router hook: starts staging the keys of one controller message.
+void beginCommandMessage()
+{
+  dispatcher->beginMessage();
+}
+
+/// @brief Router hook: applies everything staged from one controller message.
+void dispatchCommandMessage()
+{
+  dispatcher->dispatch();
+}
+
+/// @brief Sends a reply to the controller session.
+void sendReply(LFAST::ReplyMessage &msg)
+{
+  std::size_t len = 0;
+  const char *text = msg.finish(len);
+  if (text == nullptr || !sessionServer->sendToController(text, len))
+    cli->printDebugMessage("Controller reply dropped.");
+}
+
+/// @brief Telemetry source for the session server.
+std::size_t buildTelemetryFrame(char *buf, std::size_t len)
+{
+  return formatTelemetryFrame(buf, len, *pVC, *dispatcher);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
@@ -0,0 +1,226 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+///
+/// @brief Routes the keys of one controller message to registered handlers
+/// @author Kevin Gilliam
+/// @date February 16th, 2023
+/// @file message_router.cpp
+///
+
+#include "message_router.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace LFAST;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////// ReplyMessage  ///////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+ReplyMessage::ReplyMessage()
+    : len(0), overflow(false)
+{
+    buf[len++] = '{';
+}
+
+void ReplyMessage::appendPair(const char *key, const char *valueText)
+{
+    if (overflow)
+        return;
+    int n = snprintf(buf + len, sizeof(buf) - len, "%s\"%s\":%s", len > 1 ? "," : "", key, valueText);
+    if (n < 0 || len + (std::size_t)n >= sizeof(buf))
+        overflow = true;
+    else
+        len += (std::size_t)n;
+}
+
+template <>
+void ReplyMessage::addKeyValuePair<double>(const char *key, double value)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%.17g", value);
+    appendPair(key, text);
+}
+
+template <>
+void ReplyMessage::addKeyValuePair<unsigned int>(const char *key, unsigned int value)
+{
+    char text[16];
+    snprintf(text, sizeof(text), "%u", value);
+    appendPair(key, text);
+}
+
+const char *ReplyMessage::finish(std::size_t &outLen)
+{
+    if (overflow || len + 2 > sizeof(buf))
+        return nullptr;
+    buf[len] = '}';
+    buf[len + 1] = '\0';
+    outLen = len + 1;
+    return buf;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////// MessageRouter  //////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const char *skipSpace(const char *p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+        p++;
+    return p;
+}
+
+/// @brief Skips one JSON value (number, string, literal or nested object/array).
+static const char *skipValue(const char *p)
+{
+    int depth = 0;
+    bool inString = false;
+    for (; *p != '\0'; p++)
+    {
+        if (inString)
+        {
+            if (*p == '\\' && p[1] != '\0')
+                p++;
+            else if (*p == '"')
+                inString = false;
+            continue;
+        }
+        if (*p == '"')
+            inString = true;
+        else if (*p == '{' || *p == '[')
+            depth++;
+        else if (*p == '}' || *p == ']')
+        {
+            if (depth == 0)
+                return p;
+            depth--;
+        }
+        else if (*p == ',' && depth == 0)
+            return p;
+    }
+    return p;
+}
+
+MessageRouter::MessageRouter(const char *filter_)
+    : filter(filter_), numHandlers(0), beginHook(nullptr), endHook(nullptr),
+      numRouted(0), numRejected(0), numUnknownKeys(0)
+{
+}
+
+bool MessageRouter::addHandler(const Handler &h)
+{
+    if (numHandlers >= MAX_HANDLERS || strlen(h.key) >= MAX_KEY_LEN)
+        return false;
+    handlers[numHandlers++] = h;
+    return true;
+}
+
+template <>
+bool MessageRouter::registerMessageHandler<double>(const char *key, void (*fn)(double))
+{
+    return addHandler({key, false, fn, nullptr});
+}
+
+template <>
+bool MessageRouter::registerMessageHandler<unsigned int>(const char *key, void (*fn)(unsigned int))
+{
+    return addHandler({key, true, nullptr, fn});
+}
+
+void MessageRouter::setMessageHooks(MessageHook begin, MessageHook end)
+{
+    beginHook = begin;
+    endHook = end;
+}
+
+const MessageRouter::Handler *MessageRouter::findHandler(const char *key) const
+{
+    for (uint8_t ii = 0; ii < numHandlers; ii++)
+    {
+        if (strcmp(handlers[ii].key, key) == 0)
+            return &handlers[ii];
+    }
+    return nullptr;
+}
+
+/// @brief Handles one complete message.
+/// @return false if the message is not addressed to this device's filter.
+bool MessageRouter::route(const char *msg)
+{
+    char quoted[MAX_KEY_LEN + 2];
+    snprintf(quoted, sizeof(quoted), "\"%s\"", filter);
+    const char *p = strstr(msg, quoted);
+    if (p != nullptr)
+        p = strchr(p + strlen(quoted), ':');
+    if (p != nullptr)
+        p = skipSpace(p + 1);
+    if (p == nullptr || *p != '{')
+    {
+        numRejected++;
+        return false;
+    }
+    p++;
+
+    numRouted++;
+    if (beginHook != nullptr)
+        beginHook();
+
+    while (true)
+    {
+        p = skipSpace(p);
+        if (*p == ',')
+            p = skipSpace(p + 1);
+        if (*p != '"')
+            break;
+
+        char key[MAX_KEY_LEN];
+        const char *keyEnd = strchr(p + 1, '"');
+        if (keyEnd == nullptr)
+            break;
+        std::size_t keyLen = (std::size_t)(keyEnd - (p + 1));
+        bool keyFits = keyLen < sizeof(key);
+        if (keyFits)
+        {
+            memcpy(key, p + 1, keyLen);
+            key[keyLen] = '\0';
+        }
+
+        p = skipSpace(keyEnd + 1);
+        if (*p != ':')
+            break;
+        p = skipSpace(p + 1);
+
+        char *numEnd;
+        double value = strtod(p, &numEnd);
+        const Handler *h = keyFits ? findHandler(key) : nullptr;
+        if (numEnd == p || h == nullptr)
+        {
+            numUnknownKeys++;
+            p = skipValue(p);
+            continue;
+        }
+        p = numEnd;
+
+        if (h->isUnsigned)
+            h->fnUnsigned(value > 0.0 ? (unsigned int)value : 0u);
+        else
+            h->fnDouble(value);
+    }
+
+    if (endHook != nullptr)
+        endHook();
+    return true;
+}
@@ -0,0 +1,141 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+///
+/// @brief Local timestamp clock (ENET IEEE-1588 timer) disciplined to host time
+/// @author Kevin Gilliam
+/// @date February 16th, 2023
+/// @file ptp_clock.cpp
+///
+
+#include "ptp_clock.h"
+#include "PFC_config.h"
+
+#if defined(TEENSY41)
+#include <Arduino.h>
+#include <imxrt.h>
+
+// ENET_ATCR / ENET_ATINC bit fields (i.MX RT1060 RM, section 41.5)
+#define PTP_ATCR_EN (1UL << 0)
+#define PTP_ATCR_RESTART (1UL << 9)
+#define PTP_ATCR_CAPTURE (1UL << 11)
+#define PTP_ATINC_INC(n) ((uint32_t)(n)&0x7FUL)
+#else
+#include <chrono>
+#endif
+
+#define NS_PER_SEC 1000000000LL
+
+/// @brief Returns a reference to the singleton instantiation of this class
+PtpClock &PtpClock::getClock()
+{
+    static PtpClock instance;
+    return instance;
+}
+
+PtpClock::PtpClock()
+    : syncPending(false), lastRaw(0), secondsNs(0)
+{
+}
+
+/// @brief Starts the ENET 1588 timer. Must be called after the Ethernet interface is up.
+void PtpClock::hardware_setup()
+{
+#if defined(TEENSY41)
+    ENET_ATCR = 0;
+    ENET_ATPER = NS_PER_SEC;
+    ENET_ATINC = PTP_ATINC_INC(NS_PER_SEC / ENET_TS_CLK_HZ);
+    ENET_ATCOR = 0;
+    ENET_ATCR = PTP_ATCR_RESTART;
+    ENET_ATCR = PTP_ATCR_EN;
+    lastRaw = 0;
+    secondsNs = 0;
+#endif
+}
+
+/// @brief Reads the free-running local clock, in nanoseconds since hardware_setup().
+///
+/// The 1588 timer wraps every second, so each read checks for a wrap and
+/// accumulates whole seconds. Safe to call from both the ISR and the loop.
+int64_t PtpClock::localNowNs()
+{
+#if defined(TEENSY41)
+    uint32_t primask;
+    __asm__ volatile("mrs %0, primask\n" : "=r"(primask)::);
+    __disable_irq();
+
+    ENET_ATCR |= PTP_ATCR_CAPTURE;
+    while (ENET_ATCR & PTP_ATCR_CAPTURE)
+        ;
+    uint32_t raw = ENET_ATVR;
+    if (raw < lastRaw)
+        secondsNs += NS_PER_SEC;
+    lastRaw = raw;
+    int64_t now = secondsNs + raw;
+
+    if (!primask)
+        __enable_irq();
+    return now;
+#else
+    static const auto t0 = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - t0)
+        .count();
+#endif
+}
+
+/// @brief Current best estimate of host time, in nanoseconds.
+int64_t PtpClock::hostNowNs()
+{
+    return discipline.toHostNs(localNowNs());
+}
+
+/// @brief Records the first half of a sync exchange.
+/// @return The local receive time (t2).
+int64_t PtpClock::stampSyncRequest(int64_t hostT1Ns)
+{
+    pending.t2_localRx = localNowNs();
+    pending.t1_hostTx = hostT1Ns;
+    pending.t3_localTx = pending.t2_localRx;
+    syncPending = true;
+    return pending.t2_localRx;
+}
+
+/// @brief Call immediately before sending the sync reply.
+/// @return The local transmit time (t3).
+int64_t PtpClock::stampSyncReply()
+{
+    pending.t3_localTx = localNowNs();
+    return pending.t3_localTx;
+}
+
+/// @brief Closes a sync exchange and updates the clock discipline.
+/// @return true if the sample was accepted by the servo.
+bool PtpClock::completeSync(int64_t hostT4Ns)
+{
+    if (!syncPending)
+        return false;
+    syncPending = false;
+    pending.t4_hostRx = hostT4Ns;
+    return discipline.addSample(pending);
+}
+
+/// @brief Forgets the sync state, so the clock is unsynced until the next exchange.
+///
+/// The local timer keeps running. Like completeSync(), callers on the board
+/// must disable interrupts around this.
+void PtpClock::reset()
+{
+    discipline.reset();
+    syncPending = false;
+}
@@ -0,0 +1,72 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+///
+/// @brief Token bucket rate limiting for incoming commands
+/// @author Kevin Gilliam
+/// @date February 16th, 2023
+/// @file rate_limiter.cpp
+///
+
+#include "rate_limiter.h"
+#include "PFC_config.h"
+
+using namespace LFAST;
+
+TokenBucket::TokenBucket()
+    : tokens(0.0), lastRefillNs(0), started(false), numAllowed(0), numDropped(0)
+{
+    configure(CMD_RATE_LIMIT_PER_SEC, CMD_RATE_LIMIT_BURST);
+}
+
+/// @brief Changes the limit. A rate of zero or less disables limiting.
+void TokenBucket::configure(double ratePerSec_, double burst_)
+{
+    ratePerSec = ratePerSec_;
+    burst = burst_ < 1.0 ? 1.0 : burst_;
+    if (tokens > burst)
+        tokens = burst;
+}
+
+/// @brief Takes tokens from the bucket if enough are available.
+/// @return true if the command should be accepted.
+bool TokenBucket::tryConsume(int64_t nowNs, double cost)
+{
+    if (ratePerSec <= 0.0)
+    {
+        numAllowed++;
+        return true;
+    }
+    if (!started)
+    {
+        tokens = burst;
+        lastRefillNs = nowNs;
+        started = true;
+    }
+    else if (nowNs > lastRefillNs)
+    {
+        tokens += ratePerSec * (double)(nowNs - lastRefillNs) * 1.0e-9;
+        if (tokens > burst)
+            tokens = burst;
+        lastRefillNs = nowNs;
+    }
+
+    if (tokens < cost)
+    {
+        numDropped++;
+        return false;
+    }
+    tokens -= cost;
+    numAllowed++;
+    return true;
+}
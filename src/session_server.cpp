@@ -0,0 +1,313 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+///
+/// @brief TCP sessions: one controller plus read-only telemetry subscribers
+/// @author Kevin Gilliam
+/// @date February 16th, 2023
+/// @file session_server.cpp
+///
+
+#include "session_server.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <TerminalInterface.h>
+
+using namespace LFAST;
+
+/// @brief Finds "key": <number> anywhere in a flat JSON message.
+static bool findNumberField(const char *msg, const char *key, double &value)
+{
+    char quoted[32];
+    snprintf(quoted, sizeof(quoted), "\"%s\"", key);
+    const char *p = strstr(msg, quoted);
+    if (p == nullptr)
+        return false;
+    p = strchr(p + strlen(quoted), ':');
+    if (p == nullptr)
+        return false;
+    char *end;
+    value = strtod(p + 1, &end);
+    return end != p + 1;
+}
+
+SessionServer::SessionServer(unsigned int controllerPort, unsigned int telemetryPort)
+    : controllerServer(controllerPort), telemetryServer(telemetryPort), controllerRouter(nullptr),
+      frameBuilder(nullptr), healthBuilder(nullptr), nextStart(1), numRefusedControllers(0)
+{
+    for (uint8_t ii = 0; ii < NUM_SESSION_SLOTS; ii++)
+    {
+        sessions[ii].role = ROLE_NONE;
+        closeSession(sessions[ii]);
+    }
+}
+
+void SessionServer::setupPersistentFields()
+{
+}
+
+/// @brief Brings up the Ethernet interface and starts listening on both ports.
+/// @return false if no Ethernet hardware was found.
+bool SessionServer::initializeEnetIface(const uint8_t mac[6], const uint8_t ip[4])
+{
+    Ethernet.begin((uint8_t *)mac, IPAddress(ip[0], ip[1], ip[2], ip[3]));
+    if (Ethernet.hardwareStatus() == EthernetNoHardware)
+    {
+        if (cli != nullptr)
+            cli->printDebugMessage("Ethernet hardware not found.");
+        return false;
+    }
+    controllerServer.begin();
+    telemetryServer.begin();
+    return true;
+}
+
+/// @brief Number of open telemetry sessions (the controller is not counted).
+uint8_t SessionServer::activeSessions() const
+{
+    uint8_t ct = 0;
+    for (uint8_t ii = 0; ii < NUM_SESSION_SLOTS; ii++)
+        ct += sessions[ii].role == ROLE_TELEMETRY ? 1 : 0;
+    return ct;
+}
+
+const Session *SessionServer::getSession(uint8_t idx) const
+{
+    return idx < NUM_SESSION_SLOTS ? &sessions[idx] : nullptr;
+}
+
+/// @brief Queues a reply for the controller session.
+/// @return false if no controller is connected or its transmit buffer is full.
+bool SessionServer::sendToController(const char *msg, std::size_t len)
+{
+    Session &s = sessions[CONTROLLER_SLOT];
+    if (s.role != ROLE_CONTROLLER || msg == nullptr)
+        return false;
+    return queueFrame(s, msg, len);
+}
+
+/// @brief Called once per loop(). Accepts, reads, publishes and writes for every session.
+void SessionServer::service()
+{
+    acceptController();
+    acceptSubscribers();
+
+    uint32_t nowMs = millis();
+    serviceSession(CONTROLLER_SLOT, nowMs);
+    for (uint8_t nn = 0; nn < MAX_TELEMETRY_SESSIONS; nn++)
+        serviceSession(1 + (nextStart - 1 + nn) % MAX_TELEMETRY_SESSIONS, nowMs);
+    nextStart = 1 + nextStart % MAX_TELEMETRY_SESSIONS;
+}
+
+void SessionServer::serviceSession(uint8_t idx, uint32_t nowMs)
+{
+    Session &s = sessions[idx];
+    if (s.role == ROLE_NONE)
+        return;
+    if (!s.client.connected())
+    {
+        if (s.role == ROLE_CONTROLLER && cli != nullptr)
+            cli->printDebugMessage("Controller disconnected.");
+        closeSession(s);
+        return;
+    }
+    receive(idx);
+    if (s.role == ROLE_TELEMETRY)
+        publish(idx, nowMs);
+    transmit(s);
+}
+
+/// @brief Gives a new client on PORT the controller role, or refuses it if the role is taken.
+void SessionServer::acceptController()
+{
+    EthernetClient newClient = controllerServer.accept();
+    if (!newClient)
+        return;
+
+    Session &s = sessions[CONTROLLER_SLOT];
+    if (s.role == ROLE_CONTROLLER && s.client.connected())
+    {
+        static const char refusal[] = "{\"Error\":\"controller already connected\"}";
+        newClient.write((const uint8_t *)refusal, sizeof(refusal) - 1);
+        newClient.stop();
+        numRefusedControllers++;
+        if (cli != nullptr)
+            cli->printDebugMessage("Refused a second controller connection.");
+        return;
+    }
+    closeSession(s);
+    s.client = newClient;
+    s.role = ROLE_CONTROLLER;
+    if (cli != nullptr)
+        cli->printDebugMessage("Controller session opened.");
+}
+
+void SessionServer::acceptSubscribers()
+{
+    EthernetClient newClient = telemetryServer.accept();
+    if (!newClient)
+        return;
+
+    for (uint8_t ii = 1; ii < NUM_SESSION_SLOTS; ii++)
+    {
+        if (sessions[ii].role == ROLE_NONE)
+        {
+            sessions[ii].client = newClient;
+            sessions[ii].role = ROLE_TELEMETRY;
+            if (cli != nullptr)
+                cli->printDebugMessage("Telemetry session opened.");
+            return;
+        }
+    }
+    // No free slot
+    newClient.stop();
+}
+
+void SessionServer::closeSession(Session &s)
+{
+    if (s.role != ROLE_NONE)
+        s.client.stop();
+    s.role = ROLE_NONE;
+    s.publishPrdMs = 0;
+    s.lastPublishMs = 0;
+    s.frameRequested = false;
+    s.rxLen = 0;
+    s.rxDepth = 0;
+    s.tx.clear();
+    s.stats = {};
+}
+
+/// @brief Reads up to SESSION_RX_BUDGET bytes and handles each complete JSON object.
+void SessionServer::receive(uint8_t idx)
+{
+    Session &s = sessions[idx];
+    int budget = SESSION_RX_BUDGET;
+    while (budget-- > 0 && s.client.available() > 0)
+    {
+        int c = s.client.read();
+        if (c < 0)
+            break;
+        if (s.rxDepth == 0 && c != '{')
+            continue;
+        if (s.rxLen >= SESSION_RX_BUF_SIZE - 1)
+        {
+            // Oversized message: discard it and resync on the next '{'
+            s.rxLen = 0;
+            s.rxDepth = 0;
+            continue;
+        }
+        s.rx[s.rxLen++] = (char)c;
+        if (c == '{')
+            s.rxDepth++;
+        else if (c == '}' && --s.rxDepth == 0)
+        {
+            s.rx[s.rxLen] = '\0';
+            handleRequest(idx, s.rx);
+            s.rxLen = 0;
+        }
+    }
+}
+
+void SessionServer::handleRequest(uint8_t idx, const char *msg)
+{
+    Session &s = sessions[idx];
+    s.stats.requests++;
+
+    if (s.role == ROLE_CONTROLLER)
+    {
+        if (controllerRouter != nullptr)
+            controllerRouter->route(msg);
+        return;
+    }
+
+    char reply[96];
+    int len = 0;
+    double val;
+    if (findNumberField(msg, "Ping", val))
+    {
+        len = snprintf(reply, sizeof(reply), "{\"Pong\":%.17g,\"Session\":%u}", val, (unsigned int)idx);
+    }
+    else if (findNumberField(msg, "Subscribe", val))
+    {
+        s.publishPrdMs = val > 0 ? (uint32_t)val : 0;
+        s.frameRequested = s.publishPrdMs > 0;
+    }
+    else if (findNumberField(msg, "GetTelemetry", val))
+    {
+        s.frameRequested = true;
+    }
+    else if (findNumberField(msg, "GetHealth", val))
+    {
+        if (healthBuilder == nullptr)
+            return;
+        char frame[HEALTH_FRAME_SIZE];
+        std::size_t frameLen = healthBuilder(frame, sizeof(frame));
+        if (frameLen > 0)
+            queueFrame(s, frame, frameLen);
+    }
+    else
+    {
+        len = snprintf(reply, sizeof(reply), "{\"Error\":\"read-only session\"}");
+    }
+
+    if (len > 0)
+        queueFrame(s, reply, (std::size_t)len);
+}
+
+/// @brief Queues a telemetry frame if one was requested or the session's period has elapsed.
+void SessionServer::publish(uint8_t idx, uint32_t nowMs)
+{
+    Session &s = sessions[idx];
+    bool due = s.frameRequested ||
+               (s.publishPrdMs > 0 && nowMs - s.lastPublishMs >= s.publishPrdMs);
+    if (!due || frameBuilder == nullptr)
+        return;
+    s.frameRequested = false;
+    s.lastPublishMs = nowMs;
+
+    char frame[SESSION_FRAME_SIZE];
+    std::size_t len = frameBuilder(frame, sizeof(frame));
+    if (len > 0)
+        queueFrame(s, frame, len);
+}
+
+bool SessionServer::queueFrame(Session &s, const char *frame, std::size_t len)
+{
+    if (!s.tx.push(frame, len))
+    {
+        s.stats.framesDropped++;
+        return false;
+    }
+    s.stats.framesQueued++;
+    return true;
+}
+
+/// @brief Writes up to SESSION_TX_BUDGET bytes from the session's transmit buffer.
+void SessionServer::transmit(Session &s)
+{
+    std::size_t budget = SESSION_TX_BUDGET;
+    while (budget > 0 && s.tx.size() > 0)
+    {
+        std::size_t len;
+        const char *data = s.tx.front(len);
+        if (len > budget)
+            len = budget;
+        std::size_t sent = s.client.write((const uint8_t *)data, len);
+        if (sent == 0)
+            break;
+        s.tx.pop(sent);
+        s.stats.bytesSent += sent;
+        budget -= sent;
+    }
+}
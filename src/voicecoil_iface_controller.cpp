@@ -29,6 +29,8 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 #include "PFC_config.h"
 #include "teensy41_device.h"
 #include "TimerOne.h"
+#include "ptp_clock.h"
+#include "health_monitor.h"
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////// Control Functions  //////////////////////////////////////
@@ -41,14 +43,14 @@ using namespace LFAST;
 /// class. It should use getDeviceController() which will return a reference to the same
 /// object as is used in the main.cpp code, since the device controller is a singleton.
 ///
-// void primaryMirrorControl_ISR()
-// {
-//     noInterrupts();
+void voiceCoilControl_ISR()
+{
+    noInterrupts();
 
-//     VoiceCoilInterfaceController &dc = VoiceCoilInterfaceController::getDeviceController();
-//     dc.doInterruptStuff();
-//     interrupts();
-// }
+    VoiceCoilInterfaceController &dc = VoiceCoilInterfaceController::getDeviceController();
+    dc.doInterruptStuff();
+    interrupts();
+}
 
 /// @brief Returns a reference to the singleton instantiation of this class
 ///
@@ -64,13 +66,21 @@ VoiceCoilInterfaceController &VoiceCoilInterfaceController::getDeviceController(
     return instance;
 }
 
+VoiceCoilInterfaceController::VoiceCoilInterfaceController()
+{
+    for (int ii = 0; ii < NUM_PFC_AXES; ii++)
+        setpoints[ii] = 0.0;
+    execStats = {};
+    numApplied = 0;
+}
+
 /// @brief Any code which leverages hardware on the Teensy (such as timers, interrupts, etc)
 void VoiceCoilInterfaceController::hardware_setup()
 {
     // Initialize Timer
-    // Timer1.initialize(UPDATE_PRD_US);
-    // Timer1.stop();
-    // Timer1.attachInterrupt(primaryMirrorControl_ISR);
+    Timer1.initialize(UPDATE_PRD_US);
+    Timer1.stop();
+    Timer1.attachInterrupt(voiceCoilControl_ISR);
 }
 
 void VoiceCoilInterfaceController::enableControlInterrupt()
@@ -79,21 +89,29 @@ void VoiceCoilInterfaceController::enableControlInterrupt()
 }
 
 /// @brief Stuff that happens inside the interrupt part of the device controller code.
+///
+/// Immediate setpoints are picked up from the coalescer (at most one per axis
+/// per tick). Time-tagged commands are released here, so they land on the
+/// first control tick at or after their requested execution time.
 void VoiceCoilInterfaceController::doInterruptStuff()
 {
-    static uint32_t info_1_demo_val = 0;
-    static double info_2_demo_val = 0;
-    static int32_t info_3_demo_val = 0;
+    double value;
+    for (uint8_t axis = 0; axis < NUM_PFC_AXES; axis++)
+    {
+        if (coalescer.take(axis, value))
+        {
+            setpoints[axis] = value;
+            numApplied++;
+        }
+    }
 
-    info_1_demo_val++;
-    info_2_demo_val += 0.5;
-    info_3_demo_val -= 3;
-
-#if ENABLE_TERMINAL_UPDATES
-    // cli->updatePersistentField(DeviceName, HEX_INFO_ROW, info_1_demo_val, "%#08x");
-    // cli->updatePersistentField(DeviceName, HEX_INFO_ROW, info_2_demo_val, "%0.4f");
-    // cli->updatePersistentField(DeviceName, HEX_INFO_ROW, info_3_demo_val, "%d");
-#endif
+    int64_t hostNow = PtpClock::getClock().hostNowNs();
+    TimedCommand cmd;
+    while (cmdQueue.popDue(hostNow, cmd))
+    {
+        setpoints[cmd.axis] = cmd.value;
+        recordExecError(hostNow - cmd.execTimeNs);
+    }
 }
 
 /// @brief Stuff that happens outside the interrupt part of the device controller code.
@@ -101,6 +119,111 @@ void VoiceCoilInterfaceController::doNonInterruptStuff()
 {
     static uint64_t bg_loop_ct = 0;
     // cli->updatePersistentField(DeviceName, BG_LOOP_INFO_ROW, bg_loop_ct++, "%d");
+
+#if ENABLE_TERMINAL_UPDATES
+    if (cli == nullptr)
+        return;
+    if (bg_loop_ct++ % 10000 == 0)
+    {
+        ExecTimingStats stats = getExecTimingStats();
+        const ClockDiscipline &clk = PtpClock::getClock().getDiscipline();
+        cli->updatePersistentField(DeviceName, EXEC_ERR_INFO_ROW, stats.meanAbsErrNs / 1000.0, "%0.1f us");
+        cli->updatePersistentField(DeviceName, CLOCK_SYNC_INFO_ROW, clk.lastOffsetErrorNs() / 1000.0, "%0.1f us");
+    }
+#endif
+}
+
+/// @brief Applies a setpoint on the next control tick.
+///
+/// If another setpoint for the same axis arrives before that tick, only the
+/// newest one is applied.
+void VoiceCoilInterfaceController::setSetpoint(uint8_t axis, double value)
+{
+    if (axis >= NUM_PFC_AXES)
+        return;
+    noInterrupts();
+    coalescer.post(axis, value);
+    interrupts();
+}
+
+/// @brief Queues a setpoint to be applied by the control ISR at a host time.
+///
+/// Until the first clock sync, local time is time since boot rather than host
+/// time, so an execution time could never be reached and the command would sit
+/// in the queue forever. Such commands are rejected instead.
+/// @return false if the clock is not synced, the queue is full or the axis is invalid.
+bool VoiceCoilInterfaceController::scheduleSetpoint(uint8_t axis, double value, int64_t execTimeNs)
+{
+    if (axis >= NUM_PFC_AXES)
+        return false;
+    TimedCommand cmd = {execTimeNs, axis, value};
+    noInterrupts();
+    bool queued = PtpClock::getClock().getDiscipline().isSynchronized() && cmdQueue.push(cmd);
+    if (!queued)
+        execStats.numRejected++;
+    interrupts();
+    return queued;
+}
+
+/// @brief Discards every time-tagged command which has not executed yet.
+void VoiceCoilInterfaceController::clearPendingCommands()
+{
+    noInterrupts();
+    cmdQueue.clear();
+    interrupts();
+}
+
+/// @brief Returns to the power-on state: setpoints at zero, nothing queued or
+/// waiting in the coalescer, and every counter cleared.
+void VoiceCoilInterfaceController::reset()
+{
+    noInterrupts();
+    cmdQueue.clear();
+    coalescer.clear();
+    for (int ii = 0; ii < NUM_PFC_AXES; ii++)
+        setpoints[ii] = 0.0;
+    execStats = {};
+    numApplied = 0;
+    interrupts();
+}
+
+double VoiceCoilInterfaceController::getSetpoint(uint8_t axis) const
+{
+    if (axis >= NUM_PFC_AXES)
+        return 0.0;
+    return setpoints[axis];
+}
+
+/// @brief Returns a consistent copy of the execution time statistics.
+ExecTimingStats VoiceCoilInterfaceController::getExecTimingStats() const
+{
+    noInterrupts();
+    ExecTimingStats stats = execStats;
+    interrupts();
+    return stats;
+}
+
+/// @brief Returns a consistent copy of the immediate setpoint counters.
+SetpointStats VoiceCoilInterfaceController::getSetpointStats() const
+{
+    noInterrupts();
+    SetpointStats stats = {coalescer.posted(), coalescer.merged(), numApplied};
+    interrupts();
+    return stats;
+}
+
+void VoiceCoilInterfaceController::recordExecError(int64_t errNs)
+{
+    int64_t absErr = errNs < 0 ? -errNs : errNs;
+    execStats.lastErrNs = errNs;
+    if (absErr > execStats.maxAbsErrNs)
+        execStats.maxAbsErrNs = absErr;
+    execStats.numExecuted++;
+    // Running mean, exact for the first samples and then an EWMA over ~256 commands
+    uint32_t n = execStats.numExecuted < 256 ? execStats.numExecuted : 256;
+    execStats.meanAbsErrNs += ((double)absErr - execStats.meanAbsErrNs) / n;
+
+    HealthMonitor::getMonitor().update(EXEC_TIME_CH, (double)errNs);
 }
 
 /// @brief Creates persistent field labels for the terminal interface.
@@ -114,6 +237,8 @@ void VoiceCoilInterfaceController::setupPersistentFields()
     // cli->addPersistentField(DeviceName, "[Dec Info (interrupt)]", DEC_INFO);
     // cli->addPersistentField(DeviceName, "[Callback Counter]", CALLBACK_INFO_ROW);
     // cli->addPersistentField(DeviceName, "[BG Loop Counter]", BG_LOOP_INFO_ROW);
+    cli->addPersistentField(DeviceName, "[Timed Cmd Mean |Err|]", EXEC_ERR_INFO_ROW);
+    cli->addPersistentField(DeviceName, "[Clock Sync Error]", CLOCK_SYNC_INFO_ROW);
 }
 
 /// @brief Function to be called when a callback is received over TCP.
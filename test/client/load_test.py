@@ -0,0 +1,89 @@
+import socket
+import json
+import time
+import argparse
+
+# Host load test: streams SetTip/SetTilt to the PFC as fast as requested,
+# then reads back how many setpoints were merged, applied and dropped.
+
+target_host = '192.168.121.177'
+target_port = 4500
+message_filter = 'DeviceFilterStr'
+
+counter_keys = ["CmdReceived", "CmdPosted", "CmdMerged", "CmdApplied", "CmdRateLimited", "CmdDropped",
+                "ExecRejected", "ExecPending"]
+
+
+def encode(body):
+    return bytes(json.dumps({message_filter: body}), encoding='utf-8')
+
+
+def find_key(obj, key):
+    if isinstance(obj, dict):
+        if key in obj:
+            return obj[key]
+        for v in obj.values():
+            found = find_key(v, key)
+            if found is not None:
+                return found
+    return None
+
+
+def read_counters(client):
+    client.send(encode({"GetTelemetry": 0}))
+    raw = client.recv(4096).decode('utf-8').strip('\0').strip()
+    telem = json.loads(raw) if raw else {}
+    return dict((key, find_key(telem, key) or 0) for key in counter_keys)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--host', default=target_host)
+    parser.add_argument('--port', type=int, default=target_port)
+    parser.add_argument('--rate', type=float, default=5000, help='messages per second')
+    parser.add_argument('--duration', type=float, default=10.0, help='seconds')
+    parser.add_argument('--limit', type=float, default=None, help='set the global setpoint rate limit first')
+    parser.add_argument('--burst', type=float, default=None)
+    args = parser.parse_args()
+
+    client = socket.socket()
+    client.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    client.connect((args.host, args.port))
+    try:
+        if args.limit is not None or args.burst is not None:
+            body = {}
+            if args.limit is not None:
+                body["SetRateLimit"] = args.limit
+            if args.burst is not None:
+                body["SetRateBurst"] = args.burst
+            client.send(encode(body))
+
+        before = read_counters(client)
+
+        period = 1.0 / args.rate
+        sent = 0
+        start = time.perf_counter()
+        next_send = start
+        while time.perf_counter() - start < args.duration:
+            angle = 1.0e-4 * (sent % 1000)
+            client.send(encode({"SetTip": angle, "SetTilt": -angle}))
+            sent += 1
+            next_send += period
+            delay = next_send - time.perf_counter()
+            if delay > 0:
+                time.sleep(delay)
+        elapsed = time.perf_counter() - start
+
+        # Let the board drain whatever is still in its receive buffer
+        time.sleep(0.5)
+        after = read_counters(client)
+
+        print('sent %d messages in %.2f s (%.0f msg/s)' % (sent, elapsed, sent / elapsed))
+        for key in counter_keys:
+            print('%-16s %d' % (key, after[key] - before[key]))
+    finally:
+        client.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,115 @@
+import socket
+import json
+import time
+import threading
+import argparse
+
+# Session load test: opens a growing number of telemetry sessions on the
+# telemetry port, each subscribed to periodic frames and pinging the board,
+# and reports per-session round-trip latency at each session count.
+
+target_host = '192.168.121.177'
+telemetry_port = 4501
+
+
+def split_objects(buf):
+    # Returns (complete JSON objects, leftover text)
+    objs = []
+    depth = 0
+    start = None
+    for ii, c in enumerate(buf):
+        if c == '{':
+            if depth == 0:
+                start = ii
+            depth += 1
+        elif c == '}' and depth > 0:
+            depth -= 1
+            if depth == 0:
+                objs.append(buf[start:ii + 1])
+                start = None
+    leftover = buf[start:] if start is not None else ''
+    return objs, leftover
+
+
+class SessionWorker(threading.Thread):
+    def __init__(self, host, port, pings, interval, subscribe_ms):
+        threading.Thread.__init__(self)
+        self.sock = socket.create_connection((host, port), timeout=2.0)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.pings = pings
+        self.interval = interval
+        self.subscribe_ms = subscribe_ms
+        self.latencies = []
+        self.frames = 0
+        self.lost = 0
+
+    def run(self):
+        buf = ''
+        try:
+            if self.subscribe_ms > 0:
+                self.sock.send(bytes(json.dumps({"Subscribe": self.subscribe_ms}), 'utf-8'))
+            for seq in range(self.pings):
+                sent = time.perf_counter()
+                self.sock.send(bytes(json.dumps({"Ping": seq}), 'utf-8'))
+                got_pong = False
+                while not got_pong:
+                    try:
+                        data = self.sock.recv(4096)
+                    except socket.timeout:
+                        break
+                    if not data:
+                        return
+                    objs, buf = split_objects(buf + data.decode('utf-8', 'ignore'))
+                    for obj in objs:
+                        msg = json.loads(obj)
+                        if msg.get("Pong") == seq:
+                            self.latencies.append(time.perf_counter() - sent)
+                            got_pong = True
+                        elif "Telemetry" in msg:
+                            self.frames += 1
+                if not got_pong:
+                    self.lost += 1
+                time.sleep(self.interval)
+        finally:
+            self.sock.close()
+
+
+def percentile(values, p):
+    if not values:
+        return float('nan')
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(p * len(ordered)))]
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--host', default=target_host)
+    parser.add_argument('--port', type=int, default=telemetry_port)
+    parser.add_argument('--max-sessions', type=int, default=6)
+    parser.add_argument('--pings', type=int, default=200)
+    parser.add_argument('--interval', type=float, default=0.005)
+    parser.add_argument('--subscribe-ms', type=int, default=20)
+    args = parser.parse_args()
+
+    print('%8s %8s %10s %10s %10s %8s %8s' %
+          ('sessions', 'session', 'mean[ms]', 'p50[ms]', 'p99[ms]', 'lost', 'frames'))
+    count = 1
+    while count <= args.max_sessions:
+        workers = [SessionWorker(args.host, args.port, args.pings, args.interval, args.subscribe_ms)
+                   for _ in range(count)]
+        for w in workers:
+            w.start()
+        for w in workers:
+            w.join()
+        for idx, w in enumerate(workers):
+            lat = w.latencies
+            mean = sum(lat) / len(lat) if lat else float('nan')
+            print('%8d %8d %10.3f %10.3f %10.3f %8d %8d' %
+                  (count, idx, mean * 1e3, percentile(lat, 0.5) * 1e3,
+                   percentile(lat, 0.99) * 1e3, w.lost, w.frames))
+        count = count * 2 if count * 2 <= args.max_sessions or count == args.max_sessions else args.max_sessions
+        time.sleep(0.5)
+
+
+if __name__ == '__main__':
+    main()
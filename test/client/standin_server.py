@@ -0,0 +1,274 @@
+import socket
+import select
+import json
+import time
+import argparse
+
+# Host-side stand-in for the PFC controller port.
+#
+# Speaks the same framing and keys as the board for the clock sync and timed
+# command protocol (Handshake, SyncT1/SyncT4, ExecTime + SetTip/SetTilt/SetFocus,
+# GetTelemetry), so time_reference.py and load_test.py can be run end to end
+# on one machine:
+#
+#   python3 standin_server.py --port 4500 &
+#   python3 time_reference.py --host 127.0.0.1
+#
+# The board clock is simulated as host time plus a fixed offset and a rate
+# error, and is disciplined with the same PI loop as ClockDiscipline. Like the
+# board, t2 and t3 are software stamps. Only one controller is served at a
+# time; a second one is refused.
+
+message_filter = 'DeviceFilterStr'
+axis_keys = ["SetTip", "SetTilt", "SetFocus"]
+
+# Matches PFC_config.h
+update_prd_s = 100e-6
+sync_kp = 0.5
+sync_ki = 0.1
+sync_max_rtt_ns = 5000000
+sync_step_ns = 10000000
+max_pending = 32
+
+
+class SimClock:
+    """Board timer: host time with an offset and a rate error."""
+
+    def __init__(self, offset_s, drift_ppm):
+        self.start = time.time()
+        self.offset_ns = int(offset_s * 1e9)
+        self.rate = drift_ppm * 1e-6
+
+    def local_now_ns(self):
+        elapsed = time.time() - self.start
+        return int((self.start + elapsed * (1.0 + self.rate)) * 1e9) + self.offset_ns
+
+
+class Discipline:
+    """Python copy of LFAST::ClockDiscipline."""
+
+    def __init__(self):
+        self.synced = False
+        self.ref_local = 0
+        self.ref_offset = 0
+        self.rate = 0.0
+        self.last_error = 0
+        self.last_delay = 0
+
+    def offset_at(self, local_ns):
+        return self.ref_offset + int(round(self.rate * (local_ns - self.ref_local)))
+
+    def to_host_ns(self, local_ns):
+        return local_ns + self.offset_at(local_ns)
+
+    def to_local_ns(self, host_ns):
+        return host_ns - self.offset_at(host_ns - self.ref_offset)
+
+    def add_sample(self, t1, t2, t3, t4):
+        delay = (t4 - t1) - (t3 - t2)
+        if delay < 0 or delay > sync_max_rtt_ns:
+            return False
+        self.last_delay = delay
+        meas = ((t1 - t2) + (t4 - t3)) // 2
+        mid = t2 + (t3 - t2) // 2
+        if not self.synced:
+            self.ref_local, self.ref_offset, self.rate = mid, meas, 0.0
+            self.last_error = 0
+            self.synced = True
+            return True
+        predicted = self.offset_at(mid)
+        err = meas - predicted
+        self.last_error = err
+        if abs(err) > sync_step_ns:
+            self.ref_local, self.ref_offset, self.rate = mid, meas, 0.0
+        else:
+            if mid > self.ref_local:
+                self.rate += sync_ki * err / (mid - self.ref_local)
+            self.ref_offset = predicted + int(round(sync_kp * err))
+            self.ref_local = mid
+        return True
+
+
+class Board:
+    def __init__(self, clock):
+        self.clock = clock
+        self.disc = Discipline()
+        self.sync_pending = None
+        self.setpoint = [0.0, 0.0, 0.0]
+        self.pending = []  # (local exec ns, {axis: value})
+        self.exec_errs = []
+        self.counters = dict((key, 0) for key in
+                             ["CmdReceived", "CmdPosted", "CmdMerged", "CmdApplied",
+                              "CmdRateLimited", "CmdDropped", "ExecRejected"])
+
+    def handle(self, body):
+        """Handles one controller message. Returns the reply object, or None."""
+        reply = {}
+        staged = {}
+        exec_time = None
+        for key, value in body.items():
+            if not isinstance(value, (int, float)):
+                continue
+            if key == "Handshake":
+                if int(value) == 0xDEAD:
+                    reply["Handshake"] = 0xBEEF
+            elif key == "ExecTime":
+                exec_time = value
+            elif key in axis_keys:
+                self.counters["CmdReceived"] += 1
+                if axis_keys.index(key) in staged:
+                    self.counters["CmdMerged"] += 1
+                staged[axis_keys.index(key)] = value
+            elif key == "SyncT1":
+                t2 = self.clock.local_now_ns()
+                t3 = self.clock.local_now_ns()
+                self.sync_pending = (int(value * 1e9), t2, t3)
+                reply["SyncT2"] = t2 * 1e-9
+                reply["SyncT3"] = t3 * 1e-9
+            elif key == "SyncT4":
+                if self.sync_pending is not None:
+                    t1, t2, t3 = self.sync_pending
+                    self.disc.add_sample(t1, t2, t3, int(value * 1e9))
+                    self.sync_pending = None
+            elif key == "GetTelemetry":
+                reply.update(self.telemetry())
+        if staged:
+            self.dispatch(staged, exec_time)
+        return reply or None
+
+    def dispatch(self, staged, exec_time):
+        if exec_time is None:
+            for axis, value in staged.items():
+                self.setpoint[axis] = value
+            self.counters["CmdPosted"] += len(staged)
+            self.counters["CmdApplied"] += len(staged)
+            return
+        if not self.disc.synced or len(self.pending) >= max_pending:
+            self.counters["ExecRejected"] += 1
+            self.counters["CmdDropped"] += len(staged)
+            return
+        self.pending.append((self.disc.to_local_ns(int(exec_time * 1e9)), staged))
+        self.pending.sort(key=lambda p: p[0])
+
+    def tick(self):
+        """Control tick: applies timed commands which are due."""
+        now = self.clock.local_now_ns()
+        while self.pending and self.pending[0][0] <= now:
+            due, staged = self.pending.pop(0)
+            for axis, value in staged.items():
+                self.setpoint[axis] = value
+            self.counters["CmdApplied"] += len(staged)
+            self.exec_errs.append(now - due)
+
+    def telemetry(self):
+        errs = self.exec_errs
+        telem = {
+            "HostTime": self.disc.to_host_ns(self.clock.local_now_ns()) * 1e-9,
+            "ClockSynced": 1 if self.disc.synced else 0,
+            "ClockOffsetErr": self.disc.last_error * 1e-9,
+            "ClockRoundTrip": self.disc.last_delay * 1e-9,
+            "ClockRatePpb": self.disc.rate * 1e9,
+            "ExecErrLast": (errs[-1] if errs else 0) * 1e-9,
+            "ExecErrMax": (max(abs(e) for e in errs) if errs else 0) * 1e-9,
+            "ExecErrMean": (sum(abs(e) for e in errs) / len(errs) if errs else 0) * 1e-9,
+            "ExecCount": len(errs),
+            "ExecPending": len(self.pending),
+        }
+        telem.update(self.counters)
+        return telem
+
+
+def split_messages(buf):
+    """Splits complete top-level JSON objects off the front of buf, like SessionServer."""
+    messages = []
+    depth = 0
+    start = None
+    in_string = False
+    escaped = False
+    for ii, ch in enumerate(buf):
+        if in_string:
+            if escaped:
+                escaped = False
+            elif ch == '\\':
+                escaped = True
+            elif ch == '"':
+                in_string = False
+        elif ch == '"':
+            in_string = True
+        elif ch == '{':
+            if depth == 0:
+                start = ii
+            depth += 1
+        elif ch == '}' and depth > 0:
+            depth -= 1
+            if depth == 0:
+                messages.append(buf[start:ii + 1])
+                start = None
+    rest = buf[start:] if start is not None else ''
+    return messages, rest
+
+
+def send_reply(conn, obj):
+    conn.sendall(bytes(json.dumps(obj), encoding='utf-8'))
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=4500)
+    parser.add_argument('--offset', type=float, default=2.5, help='board clock offset from host, in seconds')
+    parser.add_argument('--drift', type=float, default=20.0, help='board clock rate error, in ppm')
+    args = parser.parse_args()
+
+    board = Board(SimClock(args.offset, args.drift))
+    listener = socket.socket()
+    listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    listener.bind((args.host, args.port))
+    listener.listen(4)
+    print('stand-in PFC listening on %s:%d' % (args.host, args.port))
+
+    controller = None
+    buf = ''
+    next_tick = time.perf_counter()
+    while True:
+        socks = [listener] + ([controller] if controller is not None else [])
+        readable, _, _ = select.select(socks, [], [], update_prd_s)
+
+        for sock in readable:
+            if sock is listener:
+                conn, addr = listener.accept()
+                conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+                if controller is not None:
+                    send_reply(conn, {"Error": "controller already connected"})
+                    conn.close()
+                    continue
+                controller, buf = conn, ''
+                print('controller connected from %s:%d' % addr)
+                continue
+
+            data = sock.recv(4096)
+            if not data:
+                controller.close()
+                controller = None
+                print('controller disconnected')
+                continue
+            messages, buf = split_messages(buf + data.decode('utf-8', errors='replace'))
+            for raw in messages:
+                try:
+                    msg = json.loads(raw)
+                except ValueError:
+                    continue
+                body = msg.get(message_filter) if isinstance(msg, dict) else None
+                if not isinstance(body, dict):
+                    continue
+                reply = board.handle(body)
+                if reply is not None:
+                    send_reply(controller, reply)
+
+        while time.perf_counter() >= next_tick:
+            board.tick()
+            next_tick += update_prd_s
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,92 @@
+import socket
+import json
+import time
+import argparse
+
+# Stand-in for the observatory host time reference.
+#
+# Connects to the PFC, periodically runs the SyncT1/SyncT4 exchange so the
+# board can discipline its clock to this machine's clock, then schedules a
+# few time-tagged moves and reads back the achieved execution error.
+
+target_host = '192.168.121.177'
+target_port = 4500
+message_filter = 'DeviceFilterStr'
+
+
+def send(client, body):
+    client.send(bytes(json.dumps({message_filter: body}), encoding='utf-8'))
+
+
+def find_key(obj, key):
+    # Replies may be wrapped in a message name, so search the whole document
+    if isinstance(obj, dict):
+        if key in obj:
+            return obj[key]
+        for v in obj.values():
+            found = find_key(v, key)
+            if found is not None:
+                return found
+    return None
+
+
+def recv_json(client):
+    raw = client.recv(4096).decode('utf-8').strip('\0').strip()
+    return json.loads(raw) if raw else {}
+
+
+def sync_once(client):
+    t1 = time.time()
+    send(client, {"SyncT1": t1})
+    reply = recv_json(client)
+    t4 = time.time()
+    send(client, {"SyncT4": t4})
+    t2 = find_key(reply, "SyncT2")
+    t3 = find_key(reply, "SyncT3")
+    if t2 is None or t3 is None:
+        return None
+    # Host-minus-local offset and round trip, as the board computes them
+    offset = ((t1 - t2) + (t4 - t3)) / 2
+    delay = (t4 - t1) - (t3 - t2)
+    return offset, delay
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--host', default=target_host)
+    parser.add_argument('--port', type=int, default=target_port)
+    parser.add_argument('--syncs', type=int, default=50)
+    parser.add_argument('--period', type=float, default=0.2)
+    parser.add_argument('--moves', type=int, default=10)
+    parser.add_argument('--lead', type=float, default=0.5, help='seconds between scheduling and execution')
+    args = parser.parse_args()
+
+    client = socket.socket()
+    client.connect((args.host, args.port))
+    try:
+        send(client, {"Handshake": 0xDEAD})
+        print(recv_json(client))
+
+        for ii in range(args.syncs):
+            result = sync_once(client)
+            if result is not None:
+                print('sync %3d: offset %+.6f s, round trip %.1f us' % (ii, result[0], result[1] * 1e6))
+            time.sleep(args.period)
+
+        for ii in range(args.moves):
+            exec_time = time.time() + args.lead
+            send(client, {"ExecTime": exec_time, "SetTip": 0.001 * ii, "SetTilt": -0.001 * ii})
+            time.sleep(args.lead + 0.1)
+            sync_once(client)
+
+        send(client, {"GetTelemetry": 0})
+        telem = recv_json(client)
+        for key in ["ClockOffsetErr", "ClockRoundTrip", "ClockRatePpb",
+                    "ExecErrLast", "ExecErrMax", "ExecErrMean", "ExecCount", "ExecRejected"]:
+            print('%-16s %s' % (key, find_key(telem, key)))
+    finally:
+        client.close()
+
+
+if __name__ == '__main__':
+    main()
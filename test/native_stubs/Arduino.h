@@ -0,0 +1,48 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+// Host-side stand-in for the parts of the Arduino core used by the controllers.
+// Only used by the native test environment (see platformio.ini).
+#ifndef NATIVE_STUB_ARDUINO_H
+#define NATIVE_STUB_ARDUINO_H
+
+#include <chrono>
+#include <cstdint>
+
+typedef uint8_t byte;
+
+#define A0 14
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+inline uint32_t micros()
+{
+    static const auto t0 = std::chrono::steady_clock::now();
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - t0)
+        .count();
+}
+
+inline uint32_t millis() { return micros() / 1000; }
+
+/// Tests set the value the next analogRead() returns.
+inline int &nativeAnalogValue()
+{
+    static int value = 0;
+    return value;
+}
+
+inline int analogRead(uint8_t pin) { return nativeAnalogValue(); }
+
+#endif
@@ -0,0 +1,41 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+// Host-side stand-in for the LFAST_Device base class.
+#ifndef NATIVE_STUB_LFAST_DEVICE_H
+#define NATIVE_STUB_LFAST_DEVICE_H
+
+#include <string>
+#include "TerminalInterface.h"
+
+class LFAST_Device
+{
+public:
+    virtual ~LFAST_Device() {}
+
+    void connectTerminalInterface(TerminalInterface *_cli, std::string name)
+    {
+        cli = _cli;
+        DeviceName = name;
+        setupPersistentFields();
+    }
+    virtual void setupPersistentFields() = 0;
+
+protected:
+    LFAST_Device() : cli(nullptr) {}
+
+    TerminalInterface *cli;
+    std::string DeviceName;
+};
+
+#endif
@@ -0,0 +1,137 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+// Host-side stand-in for the parts of NativeEthernet used by SessionServer.
+// A client is a pair of in-memory byte streams which tests fill and inspect;
+// nativeQueueClient() makes one appear on a server's next accept().
+#ifndef NATIVE_STUB_NATIVE_ETHERNET_H
+#define NATIVE_STUB_NATIVE_ETHERNET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+
+struct NativeSocket
+{
+    NativeSocket() : connected(true), stopped(false), maxWrite(SIZE_MAX) {}
+
+    std::string toDevice;   // Bytes the device will read
+    std::string fromDevice; // Bytes the device wrote
+    bool connected;
+    bool stopped;
+    std::size_t maxWrite;   // Per-call write limit, to model a slow client
+};
+
+class EthernetClient
+{
+public:
+    EthernetClient() {}
+    explicit EthernetClient(std::shared_ptr<NativeSocket> sock_) : sock(sock_) {}
+
+    explicit operator bool() const { return sock != nullptr; }
+    bool connected() { return sock != nullptr && sock->connected && !sock->stopped; }
+    int available() { return connected() ? (int)sock->toDevice.size() : 0; }
+
+    int read()
+    {
+        if (available() <= 0)
+            return -1;
+        int c = (unsigned char)sock->toDevice[0];
+        sock->toDevice.erase(0, 1);
+        return c;
+    }
+
+    std::size_t write(const uint8_t *data, std::size_t len)
+    {
+        if (!connected())
+            return 0;
+        if (len > sock->maxWrite)
+            len = sock->maxWrite;
+        sock->fromDevice.append((const char *)data, len);
+        return len;
+    }
+
+    void stop()
+    {
+        if (sock != nullptr)
+            sock->stopped = true;
+    }
+
+private:
+    std::shared_ptr<NativeSocket> sock;
+};
+
+/// Clients waiting to be accepted, by port.
+inline std::map<uint16_t, std::deque<EthernetClient>> &nativePendingClients()
+{
+    static std::map<uint16_t, std::deque<EthernetClient>> pending;
+    return pending;
+}
+
+/// Connects a new client to port and returns its socket.
+inline std::shared_ptr<NativeSocket> nativeQueueClient(uint16_t port)
+{
+    std::shared_ptr<NativeSocket> sock = std::make_shared<NativeSocket>();
+    nativePendingClients()[port].push_back(EthernetClient(sock));
+    return sock;
+}
+
+class EthernetServer
+{
+public:
+    explicit EthernetServer(uint16_t port_) : port(port_) {}
+
+    void begin() {}
+
+    EthernetClient accept()
+    {
+        std::deque<EthernetClient> &pending = nativePendingClients()[port];
+        if (pending.empty())
+            return EthernetClient();
+        EthernetClient c = pending.front();
+        pending.pop_front();
+        return c;
+    }
+
+private:
+    uint16_t port;
+};
+
+class IPAddress
+{
+public:
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets{a, b, c, d} {}
+
+private:
+    uint8_t octets[4];
+};
+
+enum EthernetHardwareStatus
+{
+    EthernetNoHardware,
+    EthernetOtherHardware
+};
+
+class EthernetClass
+{
+public:
+    void begin(uint8_t *mac, IPAddress ip) {}
+    EthernetHardwareStatus hardwareStatus() { return EthernetOtherHardware; }
+};
+
+static EthernetClass Ethernet;
+
+#endif
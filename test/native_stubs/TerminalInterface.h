@@ -0,0 +1,37 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+// Host-side stand-in for LFAST_Device's TerminalInterface. Records calls so
+// tests can check what a controller tried to print.
+#ifndef NATIVE_STUB_TERMINAL_INTERFACE_H
+#define NATIVE_STUB_TERMINAL_INTERFACE_H
+
+#include <string>
+
+class TerminalInterface
+{
+public:
+    TerminalInterface() : numFields(0), numUpdates(0), numDebugMessages(0) {}
+
+    void addPersistentField(const std::string &device, const std::string &label, int row) { numFields++; }
+    template <typename T>
+    void updatePersistentField(const std::string &device, int row, T value, const char *fmt = nullptr) { numUpdates++; }
+    void printPersistentFieldLabels() {}
+    void printDebugMessage(const std::string &msg) { numDebugMessages++; }
+
+    int numFields;
+    int numUpdates;
+    int numDebugMessages;
+};
+
+#endif
@@ -0,0 +1,33 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+// Host-side stand-in for TimerOne. The native tests drive the ISR by hand.
+#ifndef NATIVE_STUB_TIMER_ONE_H
+#define NATIVE_STUB_TIMER_ONE_H
+
+class TimerOne
+{
+public:
+    TimerOne() : isr(nullptr), running(false) {}
+    void initialize(unsigned long) {}
+    void start() { running = true; }
+    void stop() { running = false; }
+    void attachInterrupt(void (*fn)()) { isr = fn; }
+
+    void (*isr)();
+    bool running;
+};
+
+static TimerOne Timer1;
+
+#endif
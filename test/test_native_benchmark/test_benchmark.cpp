@@ -0,0 +1,231 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+#include <unity.h>
+
+#include "voicecoil_iface_controller.h"
+#include "command_dispatcher.h"
+#include "ptp_clock.h"
+#include "health_monitor.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC 1
+#else
+#define BENCH_HAS_TSC 0
+#endif
+
+// Benchmarks for the per-tick, per-message and per-frame paths. Results are
+// written as JSON to $PFC_BENCH_OUT (default bench_results.json) so they can
+// be compared between releases.
+//
+// On x86 the time stamp counter is also read around each run. It ticks at a
+// fixed reference rate, not at the core clock, so tsc_ticks_per_op is only
+// comparable between runs on the same machine and is not a cycle count.
+
+using namespace LFAST;
+
+static const int BENCH_ITERATIONS = 200000;
+
+struct BenchResult
+{
+    std::string name;
+    int iterations;
+    double nsPerOp;
+    double tscTicksPerOp;
+};
+
+static std::vector<BenchResult> results;
+
+/// Calls made by runBenchmark(), warm-up included.
+static const int BENCH_CALLS = BENCH_ITERATIONS + BENCH_ITERATIONS / 10;
+
+static inline uint64_t readTsc()
+{
+#if BENCH_HAS_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/// @brief Times fn over BENCH_ITERATIONS calls and records the per-call cost.
+template <typename F>
+static void runBenchmark(const char *name, F fn)
+{
+    // Warm up caches and branch predictors
+    for (int ii = 0; ii < BENCH_ITERATIONS / 10; ii++)
+        fn(ii);
+
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = readTsc();
+    for (int ii = 0; ii < BENCH_ITERATIONS; ii++)
+        fn(ii);
+    uint64_t c1 = readTsc();
+    auto t1 = std::chrono::steady_clock::now();
+
+    BenchResult r;
+    r.name = name;
+    r.iterations = BENCH_ITERATIONS;
+    r.nsPerOp = std::chrono::duration<double, std::nano>(t1 - t0).count() / BENCH_ITERATIONS;
+    r.tscTicksPerOp = BENCH_HAS_TSC ? (double)(c1 - c0) / BENCH_ITERATIONS : -1.0;
+    results.push_back(r);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%s: %.1f ns/op, %.0f TSC ticks/op", name, r.nsPerOp, r.tscTicksPerOp);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(r.nsPerOp > 0.0);
+}
+
+void setUp(void)
+{
+    PtpClock::getClock().reset();
+    HealthMonitor::getMonitor().reset();
+    VoiceCoilInterfaceController::getDeviceController().reset();
+}
+
+void tearDown(void)
+{
+}
+
+void bench_control_update_idle(void)
+{
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    runBenchmark("control_update_idle", [&](int) { vc.doInterruptStuff(); });
+    TEST_ASSERT_EQUAL_UINT32(0, vc.getSetpointStats().numApplied);
+}
+
+void bench_control_update_with_setpoints(void)
+{
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    runBenchmark("control_update_with_setpoints", [&](int ii) {
+        vc.setSetpoint(TIP_AXIS, ii);
+        vc.setSetpoint(TILT_AXIS, -ii);
+        vc.doInterruptStuff();
+    });
+    TEST_ASSERT_EQUAL_UINT32(2 * BENCH_CALLS, vc.getSetpointStats().numApplied);
+    TEST_ASSERT_EQUAL_DOUBLE(BENCH_ITERATIONS - 1, vc.getSetpoint(TIP_AXIS));
+}
+
+void bench_control_update_timed_command(void)
+{
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    PtpClock &clk = PtpClock::getClock();
+    // Timed commands are only accepted once the clock has synced
+    clk.stampSyncRequest(clk.localNowNs());
+    clk.stampSyncReply();
+    TEST_ASSERT_TRUE(clk.completeSync(clk.localNowNs()));
+    int64_t past = clk.hostNowNs();
+    runBenchmark("control_update_timed_command", [&](int ii) {
+        vc.scheduleSetpoint(FOCUS_AXIS, ii, past);
+        vc.doInterruptStuff();
+    });
+    ExecTimingStats stats = vc.getExecTimingStats();
+    TEST_ASSERT_EQUAL_UINT32(BENCH_CALLS, stats.numExecuted);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.numRejected);
+}
+
+void bench_command_dispatch(void)
+{
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    CommandDispatcher dispatcher(vc);
+    dispatcher.beginMessage();
+    dispatcher.stageRateLimit(0.0);
+    dispatcher.dispatch();
+
+    runBenchmark("command_dispatch", [&](int ii) {
+        dispatcher.beginMessage();
+        dispatcher.stageSetpoint(TIP_AXIS, ii);
+        dispatcher.stageSetpoint(TILT_AXIS, -ii);
+        dispatcher.dispatch();
+    });
+    vc.doInterruptStuff();
+    TEST_ASSERT_EQUAL_UINT32(2 * BENCH_CALLS, dispatcher.receivedSetpoints());
+    TEST_ASSERT_EQUAL_UINT32(0, dispatcher.droppedSetpoints());
+    TEST_ASSERT_EQUAL_DOUBLE(BENCH_ITERATIONS - 1, vc.getSetpoint(TIP_AXIS));
+}
+
+void bench_telemetry_frame(void)
+{
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    CommandDispatcher dispatcher(vc);
+    char buf[SESSION_FRAME_SIZE];
+    std::size_t total = 0;
+
+    runBenchmark("telemetry_frame", [&](int) { total += formatTelemetryFrame(buf, sizeof(buf), vc, dispatcher); });
+    TEST_ASSERT_TRUE(total > 0);
+}
+
+void bench_health_update(void)
+{
+    HealthMonitor &health = HealthMonitor::getMonitor();
+    runBenchmark("health_update", [&](int ii) { health.update(EXEC_TIME_CH, (double)(ii & 0xFF)); });
+    TEST_ASSERT_EQUAL_UINT32(BENCH_CALLS, health.snapshot().channels[EXEC_TIME_CH].count());
+}
+
+void bench_health_summary(void)
+{
+    HealthMonitor &health = HealthMonitor::getMonitor();
+    char buf[HEALTH_FRAME_SIZE];
+    std::size_t total = 0;
+
+    runBenchmark("health_summary", [&](int) { total += formatHealthSummary(buf, sizeof(buf), health.snapshot()); });
+    TEST_ASSERT_TRUE(total > 0);
+}
+
+static void writeResults()
+{
+    const char *path = getenv("PFC_BENCH_OUT");
+    if (path == nullptr)
+        path = "bench_results.json";
+    FILE *fp = fopen(path, "w");
+    TEST_ASSERT_NOT_NULL_MESSAGE(fp, "Could not open benchmark result file");
+
+    fprintf(fp, "{\n  \"tsc_available\": %s,\n  \"benchmarks\": [\n", BENCH_HAS_TSC ? "true" : "false");
+    for (std::size_t ii = 0; ii < results.size(); ii++)
+    {
+        const BenchResult &r = results[ii];
+        fprintf(fp, "    {\"name\": \"%s\", \"iterations\": %d, \"ns_per_op\": %.3f, \"tsc_ticks_per_op\": %.1f}%s\n",
+                r.name.c_str(), r.iterations, r.nsPerOp, r.tscTicksPerOp,
+                ii + 1 < results.size() ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+}
+
+void bench_write_results(void)
+{
+    writeResults();
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(bench_control_update_idle);
+    RUN_TEST(bench_control_update_with_setpoints);
+    RUN_TEST(bench_control_update_timed_command);
+    RUN_TEST(bench_command_dispatch);
+    RUN_TEST(bench_telemetry_frame);
+    RUN_TEST(bench_health_update);
+    RUN_TEST(bench_health_summary);
+    RUN_TEST(bench_write_results);
+
+    return UNITY_END();
+}
@@ -0,0 +1,605 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+#include <unity.h>
+
+#include "adc_controller.h"
+#include "laser_array_controller.h"
+#include "voicecoil_iface_controller.h"
+#include "command_dispatcher.h"
+#include "clock_discipline.h"
+#include "health_monitor.h"
+#include "ptp_clock.h"
+#include "rate_limiter.h"
+#include "setpoint_coalescer.h"
+#include "time_tagged_queue.h"
+
+#include <cstring>
+
+using namespace LFAST;
+
+static const int64_t ONE_HOUR_NS = 3600LL * 1000000000LL;
+
+/// Controllers are singletons and keep the terminal pointer, so it must outlive every test.
+static TerminalInterface testTerminal;
+
+/// Timed commands are rejected until the clock has synced, so run one exchange with zero offset.
+static void syncTestClock()
+{
+    PtpClock &clk = PtpClock::getClock();
+    clk.stampSyncRequest(clk.localNowNs());
+    clk.stampSyncReply();
+    TEST_ASSERT_TRUE(clk.completeSync(clk.localNowNs()));
+}
+
+/// Every test starts from an unsynced clock, default health thresholds and an idle voice coil.
+void setUp(void)
+{
+    PtpClock::getClock().reset();
+    HealthMonitor::getMonitor().reset();
+    VoiceCoilInterfaceController::getDeviceController().reset();
+}
+
+void tearDown(void)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ADCController
+///////////////////////////////////////////////////////////////////////////////
+
+void test_adc_controller_is_singleton(void)
+{
+    ADCController &a = ADCController::getDeviceController();
+    ADCController &b = ADCController::getDeviceController();
+    TEST_ASSERT_EQUAL_PTR(&a, &b);
+}
+
+void test_adc_controller_runs_without_terminal(void)
+{
+    TerminalInterface before = testTerminal;
+    ADCController &dc = ADCController::getDeviceController();
+    dc.hardware_setup();
+    dc.setupPersistentFields();
+    dc.doSomethingForACallback();
+
+    // Still samples the wiper, and leaves the shared test terminal alone
+    nativeAnalogValue() = 321;
+    uint32_t start = micros();
+    while (dc.getWiperPosition() != 321 && micros() - start < 100 * HEALTH_WIPER_SAMPLE_PRD_US)
+        dc.doNonInterruptStuff();
+    TEST_ASSERT_EQUAL_INT(321, dc.getWiperPosition());
+    TEST_ASSERT_EQUAL_INT(before.numFields, testTerminal.numFields);
+    TEST_ASSERT_EQUAL_INT(before.numUpdates, testTerminal.numUpdates);
+    TEST_ASSERT_EQUAL_INT(before.numDebugMessages, testTerminal.numDebugMessages);
+}
+
+void test_adc_controller_feeds_wiper_health(void)
+{
+    HealthMonitor &health = HealthMonitor::getMonitor();
+    ADCController &dc = ADCController::getDeviceController();
+
+    // The wiper is sampled every HEALTH_WIPER_SAMPLE_PRD_US, so keep looping until it is
+    nativeAnalogValue() = 512;
+    uint32_t start = micros();
+    while (dc.getWiperPosition() != 512 && micros() - start < 100 * HEALTH_WIPER_SAMPLE_PRD_US)
+        dc.doNonInterruptStuff();
+    TEST_ASSERT_EQUAL_INT(512, dc.getWiperPosition());
+    TEST_ASSERT_TRUE(health.snapshot().channels[WIPER_POSN_CH].count() >= 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// LaserArrayController
+///////////////////////////////////////////////////////////////////////////////
+
+void test_laser_controller_is_singleton(void)
+{
+    LaserArrayController &a = LaserArrayController::getDeviceController();
+    LaserArrayController &b = LaserArrayController::getDeviceController();
+    TEST_ASSERT_EQUAL_PTR(&a, &b);
+}
+
+void test_laser_controller_runs_with_terminal(void)
+{
+    TerminalInterface before = testTerminal;
+    LaserArrayController &dc = LaserArrayController::getDeviceController();
+    dc.connectTerminalInterface(&testTerminal, "Laser");
+    dc.hardware_setup();
+    dc.doNonInterruptStuff();
+    dc.doSomethingForACallback();
+
+    // The laser controller has no fields or messages yet
+    TEST_ASSERT_EQUAL_INT(before.numFields, testTerminal.numFields);
+    TEST_ASSERT_EQUAL_INT(before.numUpdates, testTerminal.numUpdates);
+    TEST_ASSERT_EQUAL_INT(before.numDebugMessages, testTerminal.numDebugMessages);
+}
+
+void test_laser_controller_feeds_no_health_channel(void)
+{
+    LaserArrayController &dc = LaserArrayController::getDeviceController();
+    dc.doNonInterruptStuff();
+    dc.doSomethingForACallback();
+
+    // There is no laser intensity sensor, so nothing is reported
+    HealthSnapshot snap = HealthMonitor::getMonitor().snapshot();
+    for (int ch = 0; ch < NUM_HEALTH_CHANNELS; ch++)
+        TEST_ASSERT_EQUAL_UINT32(0, snap.channels[ch].count());
+    TEST_ASSERT_EQUAL_UINT32(0, HealthMonitor::getMonitor().events());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// VoiceCoilInterfaceController
+///////////////////////////////////////////////////////////////////////////////
+
+void test_vc_persistent_fields_registered(void)
+{
+    int fields = testTerminal.numFields;
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    vc.connectTerminalInterface(&testTerminal, "VoiceCoil");
+    TEST_ASSERT_EQUAL_INT(fields + 2, testTerminal.numFields);
+    vc.doNonInterruptStuff();
+    TEST_ASSERT_TRUE(testTerminal.numUpdates > 0);
+}
+
+void test_vc_setpoint_applied_on_next_tick(void)
+{
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    vc.doInterruptStuff();
+    double before = vc.getSetpoint(TIP_AXIS);
+
+    vc.setSetpoint(TIP_AXIS, before + 1.0);
+    TEST_ASSERT_EQUAL_DOUBLE(before, vc.getSetpoint(TIP_AXIS));
+
+    vc.doInterruptStuff();
+    TEST_ASSERT_EQUAL_DOUBLE(before + 1.0, vc.getSetpoint(TIP_AXIS));
+}
+
+void test_vc_setpoints_coalesce_between_ticks(void)
+{
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    vc.doInterruptStuff();
+    SetpointStats s0 = vc.getSetpointStats();
+
+    for (int ii = 0; ii < 100; ii++)
+        vc.setSetpoint(TILT_AXIS, 0.01 * ii);
+    vc.doInterruptStuff();
+
+    SetpointStats s1 = vc.getSetpointStats();
+    TEST_ASSERT_EQUAL_UINT32(100, s1.numPosted - s0.numPosted);
+    TEST_ASSERT_EQUAL_UINT32(99, s1.numMerged - s0.numMerged);
+    TEST_ASSERT_EQUAL_UINT32(1, s1.numApplied - s0.numApplied);
+    TEST_ASSERT_EQUAL_DOUBLE(0.99, vc.getSetpoint(TILT_AXIS));
+}
+
+void test_vc_invalid_axis_ignored(void)
+{
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    vc.setSetpoint(NUM_PFC_AXES, 1.0);
+    TEST_ASSERT_FALSE(vc.scheduleSetpoint(NUM_PFC_AXES, 1.0, 0));
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, vc.getSetpoint(NUM_PFC_AXES));
+}
+
+void test_vc_timed_command_rejected_before_sync(void)
+{
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    TEST_ASSERT_FALSE(PtpClock::getClock().getDiscipline().isSynchronized());
+
+    TEST_ASSERT_FALSE(vc.scheduleSetpoint(TIP_AXIS, 1.0, PtpClock::getClock().hostNowNs() - 1000));
+    TEST_ASSERT_EQUAL_UINT32(0, vc.pendingCommands());
+    TEST_ASSERT_EQUAL_UINT32(1, vc.getExecTimingStats().numRejected);
+
+    // The same command is accepted once the clock has synced
+    syncTestClock();
+    TEST_ASSERT_TRUE(vc.scheduleSetpoint(TIP_AXIS, 1.0, PtpClock::getClock().hostNowNs() - 1000));
+    TEST_ASSERT_EQUAL_UINT32(1, vc.pendingCommands());
+}
+
+void test_vc_future_command_waits(void)
+{
+    syncTestClock();
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    vc.doInterruptStuff();
+    double before = vc.getSetpoint(FOCUS_AXIS);
+    int64_t later = PtpClock::getClock().hostNowNs() + ONE_HOUR_NS;
+
+    TEST_ASSERT_TRUE(vc.scheduleSetpoint(FOCUS_AXIS, before + 5.0, later));
+    vc.doInterruptStuff();
+    TEST_ASSERT_EQUAL_DOUBLE(before, vc.getSetpoint(FOCUS_AXIS));
+    TEST_ASSERT_EQUAL_UINT32(1, vc.pendingCommands());
+}
+
+void test_vc_due_command_executes_and_reports_error(void)
+{
+    syncTestClock();
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    ExecTimingStats s0 = vc.getExecTimingStats();
+    int64_t due = PtpClock::getClock().hostNowNs() - 1000000;
+
+    TEST_ASSERT_TRUE(vc.scheduleSetpoint(FOCUS_AXIS, 42.0, due));
+    vc.doInterruptStuff();
+
+    ExecTimingStats s1 = vc.getExecTimingStats();
+    TEST_ASSERT_EQUAL_DOUBLE(42.0, vc.getSetpoint(FOCUS_AXIS));
+    TEST_ASSERT_EQUAL_UINT32(1, s1.numExecuted - s0.numExecuted);
+    TEST_ASSERT_TRUE(s1.lastErrNs >= 1000000);
+    TEST_ASSERT_EQUAL_UINT32(0, vc.pendingCommands());
+}
+
+void test_vc_exec_error_feeds_health(void)
+{
+    HealthMonitor &health = HealthMonitor::getMonitor();
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    syncTestClock();
+
+    vc.scheduleSetpoint(TIP_AXIS, 1.0, PtpClock::getClock().hostNowNs() - 1000);
+    vc.doInterruptStuff();
+    TEST_ASSERT_EQUAL_UINT32(1, health.snapshot().channels[EXEC_TIME_CH].count());
+}
+
+void test_vc_commands_execute_in_time_order(void)
+{
+    syncTestClock();
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    int64_t now = PtpClock::getClock().hostNowNs();
+
+    vc.scheduleSetpoint(TIP_AXIS, 3.0, now - 1000);
+    vc.scheduleSetpoint(TIP_AXIS, 1.0, now - 3000);
+    vc.scheduleSetpoint(TIP_AXIS, 2.0, now - 2000);
+    vc.doInterruptStuff();
+    TEST_ASSERT_EQUAL_DOUBLE(3.0, vc.getSetpoint(TIP_AXIS));
+}
+
+void test_vc_full_queue_rejects(void)
+{
+    syncTestClock();
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    ExecTimingStats s0 = vc.getExecTimingStats();
+    int64_t later = PtpClock::getClock().hostNowNs() + ONE_HOUR_NS;
+
+    for (int ii = 0; ii < TIMED_CMD_QUEUE_DEPTH; ii++)
+        TEST_ASSERT_TRUE(vc.scheduleSetpoint(TIP_AXIS, ii, later + ii));
+    TEST_ASSERT_FALSE(vc.scheduleSetpoint(TIP_AXIS, 0.0, later));
+
+    ExecTimingStats s1 = vc.getExecTimingStats();
+    TEST_ASSERT_EQUAL_UINT32(1, s1.numRejected - s0.numRejected);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CommandDispatcher
+///////////////////////////////////////////////////////////////////////////////
+
+void test_dispatcher_applies_staged_setpoints(void)
+{
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    CommandDispatcher dispatcher(vc);
+
+    dispatcher.beginMessage();
+    dispatcher.stageSetpoint(TIP_AXIS, 0.25);
+    dispatcher.stageSetpoint(TILT_AXIS, -0.25);
+    dispatcher.dispatch();
+    vc.doInterruptStuff();
+
+    TEST_ASSERT_EQUAL_DOUBLE(0.25, vc.getSetpoint(TIP_AXIS));
+    TEST_ASSERT_EQUAL_DOUBLE(-0.25, vc.getSetpoint(TILT_AXIS));
+}
+
+void test_dispatcher_queues_timed_setpoints(void)
+{
+    syncTestClock();
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    CommandDispatcher dispatcher(vc);
+
+    dispatcher.beginMessage();
+    dispatcher.stageSetpoint(FOCUS_AXIS, 7.0);
+    dispatcher.setExecTime(PtpClock::getClock().hostNowNs() + ONE_HOUR_NS);
+    dispatcher.dispatch();
+    TEST_ASSERT_EQUAL_UINT32(1, vc.pendingCommands());
+}
+
+void test_dispatcher_rate_limits(void)
+{
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    CommandDispatcher dispatcher(vc);
+
+    dispatcher.beginMessage();
+    dispatcher.stageRateLimit(1.0);
+    dispatcher.stageRateBurst(5.0);
+    dispatcher.dispatch();
+
+    for (int ii = 0; ii < 20; ii++)
+    {
+        dispatcher.beginMessage();
+        dispatcher.stageSetpoint(TIP_AXIS, ii);
+        dispatcher.stageSetpoint(TILT_AXIS, ii);
+        dispatcher.dispatch();
+    }
+    TEST_ASSERT_EQUAL_UINT32(15, dispatcher.getSetpointRateLimit().dropped());
+    TEST_ASSERT_EQUAL_UINT32(30, dispatcher.droppedSetpoints());
+}
+
+void test_dispatcher_sets_health_thresholds(void)
+{
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    CommandDispatcher dispatcher(vc);
+    HealthMonitor &health = HealthMonitor::getMonitor();
+    HealthThresholds before = health.getThresholds(EXEC_TIME_CH);
+
+    // Key order within a message does not matter
+    dispatcher.beginMessage();
+    dispatcher.stageHealthMaxDrift(123.0);
+    dispatcher.stageHealthChannel(EXEC_TIME_CH);
+    dispatcher.dispatch();
+    HealthThresholds after = health.getThresholds(EXEC_TIME_CH);
+    TEST_ASSERT_EQUAL_DOUBLE(123.0, after.maxDrift);
+    TEST_ASSERT_EQUAL_DOUBLE(before.maxRms, after.maxRms);
+
+    // Without a valid channel nothing changes
+    dispatcher.beginMessage();
+    dispatcher.stageHealthChannel(NUM_HEALTH_CHANNELS);
+    dispatcher.stageHealthMaxRms(1.0);
+    dispatcher.dispatch();
+    TEST_ASSERT_EQUAL_DOUBLE(before.maxRms, health.getThresholds(EXEC_TIME_CH).maxRms);
+}
+
+void test_telemetry_frame_fits_and_is_json(void)
+{
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    CommandDispatcher dispatcher(vc);
+    char buf[SESSION_FRAME_SIZE];
+
+    std::size_t len = formatTelemetryFrame(buf, sizeof(buf), vc, dispatcher);
+    TEST_ASSERT_TRUE(len > 0);
+    TEST_ASSERT_EQUAL_size_t(strlen(buf), len);
+    TEST_ASSERT_EQUAL_CHAR('{', buf[0]);
+    TEST_ASSERT_EQUAL_CHAR('}', buf[len - 1]);
+    TEST_ASSERT_NOT_NULL(strstr(buf, "\"ExecCount\""));
+
+    TEST_ASSERT_EQUAL_size_t(0, formatTelemetryFrame(buf, 16, vc, dispatcher));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Building blocks
+///////////////////////////////////////////////////////////////////////////////
+
+struct QueueItem
+{
+    int64_t execTimeNs;
+    int id;
+};
+
+void test_queue_orders_by_time_then_fifo(void)
+{
+    TimeTaggedQueue<QueueItem, 8> q;
+    q.push({20, 0});
+    q.push({10, 1});
+    q.push({20, 2});
+    q.push({10, 3});
+
+    QueueItem item;
+    TEST_ASSERT_FALSE(q.popDue(5, item));
+    int expected[] = {1, 3, 0, 2};
+    for (int ii = 0; ii < 4; ii++)
+    {
+        TEST_ASSERT_TRUE(q.popDue(100, item));
+        TEST_ASSERT_EQUAL_INT(expected[ii], item.id);
+    }
+    TEST_ASSERT_TRUE(q.empty());
+}
+
+void test_coalescer_latest_wins(void)
+{
+    SetpointCoalescer<2> c;
+    double v;
+    TEST_ASSERT_FALSE(c.take(0, v));
+    c.post(0, 1.0);
+    c.post(0, 2.0);
+    c.post(1, 3.0);
+    TEST_ASSERT_TRUE(c.take(0, v));
+    TEST_ASSERT_EQUAL_DOUBLE(2.0, v);
+    TEST_ASSERT_FALSE(c.take(0, v));
+    TEST_ASSERT_EQUAL_UINT32(1, c.merged());
+    TEST_ASSERT_TRUE(c.anyPending());
+}
+
+void test_token_bucket_refills(void)
+{
+    TokenBucket bucket;
+    bucket.configure(1000.0, 10.0);
+    int allowed = 0;
+    for (int ii = 0; ii < 100; ii++)
+        allowed += bucket.tryConsume(0) ? 1 : 0;
+    TEST_ASSERT_EQUAL_INT(10, allowed);
+    // 5 ms at 1000/s refills 5 tokens
+    allowed = 0;
+    for (int ii = 0; ii < 100; ii++)
+        allowed += bucket.tryConsume(5000000) ? 1 : 0;
+    TEST_ASSERT_EQUAL_INT(5, allowed);
+}
+
+void test_token_bucket_disabled(void)
+{
+    TokenBucket bucket;
+    bucket.configure(0.0, 1.0);
+    for (int ii = 0; ii < 1000; ii++)
+        TEST_ASSERT_TRUE(bucket.tryConsume(0));
+}
+
+void test_channel_stats_welford(void)
+{
+    ChannelStats s;
+    double xs[] = {2, 4, 4, 4, 5, 5, 7, 9};
+    for (double x : xs)
+        s.update(x);
+    TEST_ASSERT_EQUAL_UINT32(8, s.count());
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 5.0, s.mean());
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 32.0 / 7.0, s.variance());
+    TEST_ASSERT_EQUAL_DOUBLE(2.0, s.min());
+    TEST_ASSERT_EQUAL_DOUBLE(9.0, s.max());
+}
+
+void test_channel_stats_trend_follows_drift(void)
+{
+    ChannelStats s;
+    for (int ii = 0; ii < 2000; ii++)
+        s.update(100.0);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 0.0, s.trend());
+    for (int ii = 0; ii < 200; ii++)
+        s.update(100.0 - 0.05 * ii);
+    TEST_ASSERT_TRUE(s.trend() < -1.0);
+}
+
+void test_health_threshold_raises_one_event(void)
+{
+    HealthMonitor &health = HealthMonitor::getMonitor();
+    health.takeNewEvents();
+
+    // Wiper noise alternating +-20 counts is well above HEALTH_WIPER_MAX_NOISE
+    for (int ii = 0; ii < 4 * HEALTH_MIN_SAMPLES; ii++)
+        health.update(WIPER_NOISE_CH, (ii & 1) ? 20.0 : -20.0);
+
+    TEST_ASSERT_EQUAL_UINT8(HEALTH_RMS, health.flags(WIPER_NOISE_CH));
+    TEST_ASSERT_EQUAL_UINT32(1, health.events());
+    TEST_ASSERT_EQUAL_UINT32(1UL << WIPER_NOISE_CH, health.takeNewEvents());
+    TEST_ASSERT_EQUAL_UINT32(0, health.takeNewEvents());
+
+    health.clearFlags();
+    TEST_ASSERT_EQUAL_UINT8(HEALTH_OK, health.allFlags());
+}
+
+void test_health_default_drift_check(void)
+{
+    HealthMonitor &health = HealthMonitor::getMonitor();
+
+    for (int ii = 0; ii < 2000; ii++)
+        health.update(EXEC_TIME_CH, 0.0);
+    TEST_ASSERT_EQUAL_UINT8(HEALTH_OK, health.flags(EXEC_TIME_CH));
+    // Execution error creeping up to 1.5 HEALTH_EXEC_MAX_DRIFT_NS
+    for (int ii = 0; ii < 200; ii++)
+        health.update(EXEC_TIME_CH, 1.5 * HEALTH_EXEC_MAX_DRIFT_NS * ii / 200.0);
+    TEST_ASSERT_TRUE(health.flags(EXEC_TIME_CH) & HEALTH_DRIFT);
+}
+
+void test_health_wiper_move_not_flagged_by_default(void)
+{
+    HealthMonitor &health = HealthMonitor::getMonitor();
+
+    // A commanded move: wiper steps from one end of travel to the other
+    for (int ii = 0; ii < 2000; ii++)
+        health.update(WIPER_POSN_CH, 100.0);
+    for (int ii = 0; ii < 2000; ii++)
+        health.update(WIPER_POSN_CH, 900.0);
+    TEST_ASSERT_EQUAL_UINT8(HEALTH_OK, health.flags(WIPER_POSN_CH));
+}
+
+void test_health_range_check(void)
+{
+    HealthMonitor &health = HealthMonitor::getMonitor();
+    HealthThresholds th = {0.0, 0.0, 0.0, 0.0, 1023.0};
+    health.setThresholds(WIPER_POSN_CH, th);
+
+    health.update(WIPER_POSN_CH, 500.0);
+    TEST_ASSERT_EQUAL_UINT8(HEALTH_OK, health.flags(WIPER_POSN_CH));
+    health.update(WIPER_POSN_CH, 2000.0);
+    TEST_ASSERT_EQUAL_UINT8(HEALTH_RANGE, health.flags(WIPER_POSN_CH));
+}
+
+void test_health_summary_fits(void)
+{
+    HealthMonitor &health = HealthMonitor::getMonitor();
+    for (int ch = 0; ch < NUM_HEALTH_CHANNELS; ch++)
+        health.update((HEALTH_CHANNEL)ch, -123456.789);
+
+    char buf[HEALTH_FRAME_SIZE];
+    std::size_t len = formatHealthSummary(buf, sizeof(buf), health.snapshot());
+    TEST_ASSERT_TRUE(len > 0);
+    TEST_ASSERT_EQUAL_size_t(strlen(buf), len);
+    TEST_ASSERT_NOT_NULL(strstr(buf, "\"ClockOffset\":["));
+    TEST_ASSERT_EQUAL_CHAR('}', buf[len - 1]);
+    TEST_ASSERT_EQUAL_size_t(0, formatHealthSummary(buf, 64, health.snapshot()));
+}
+
+void test_clock_discipline_tracks_offset_and_drift(void)
+{
+    ClockDiscipline d;
+    const int64_t offset = 5000000;
+    const double drift = 20.0e-6;
+    int64_t local = 0;
+    for (int ii = 0; ii < 200; ii++)
+    {
+        local += 100000000;
+        int64_t host = local + offset + (int64_t)(drift * local);
+        SyncSample s = {host - 50000, local, local + 10000, host + 60000};
+        TEST_ASSERT_TRUE(d.addSample(s));
+    }
+    int64_t host = local + offset + (int64_t)(drift * local);
+    TEST_ASSERT_TRUE(d.isSynchronized());
+    TEST_ASSERT_INT64_WITHIN(1000, host, d.toHostNs(local));
+    TEST_ASSERT_INT64_WITHIN(1000, local, d.toLocalNs(host));
+    TEST_ASSERT_DOUBLE_WITHIN(500.0, 20000.0, d.rateCorrectionPpb());
+}
+
+void test_clock_discipline_rejects_slow_exchange(void)
+{
+    ClockDiscipline d;
+    d.setMaxRoundTripNs(1000000);
+    SyncSample slow = {0, 0, 0, 2000000};
+    TEST_ASSERT_FALSE(d.addSample(slow));
+    TEST_ASSERT_FALSE(d.isSynchronized());
+    TEST_ASSERT_EQUAL_UINT32(1, d.rejectedSamples());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_adc_controller_is_singleton);
+    RUN_TEST(test_adc_controller_runs_without_terminal);
+    RUN_TEST(test_adc_controller_feeds_wiper_health);
+
+    RUN_TEST(test_laser_controller_is_singleton);
+    RUN_TEST(test_laser_controller_runs_with_terminal);
+    RUN_TEST(test_laser_controller_feeds_no_health_channel);
+
+    RUN_TEST(test_vc_persistent_fields_registered);
+    RUN_TEST(test_vc_setpoint_applied_on_next_tick);
+    RUN_TEST(test_vc_setpoints_coalesce_between_ticks);
+    RUN_TEST(test_vc_invalid_axis_ignored);
+    RUN_TEST(test_vc_timed_command_rejected_before_sync);
+    RUN_TEST(test_vc_future_command_waits);
+    RUN_TEST(test_vc_due_command_executes_and_reports_error);
+    RUN_TEST(test_vc_exec_error_feeds_health);
+    RUN_TEST(test_vc_commands_execute_in_time_order);
+    RUN_TEST(test_vc_full_queue_rejects);
+
+    RUN_TEST(test_dispatcher_applies_staged_setpoints);
+    RUN_TEST(test_dispatcher_queues_timed_setpoints);
+    RUN_TEST(test_dispatcher_rate_limits);
+    RUN_TEST(test_dispatcher_sets_health_thresholds);
+    RUN_TEST(test_telemetry_frame_fits_and_is_json);
+
+    RUN_TEST(test_queue_orders_by_time_then_fifo);
+    RUN_TEST(test_coalescer_latest_wins);
+    RUN_TEST(test_token_bucket_refills);
+    RUN_TEST(test_token_bucket_disabled);
+    RUN_TEST(test_channel_stats_welford);
+    RUN_TEST(test_channel_stats_trend_follows_drift);
+    RUN_TEST(test_health_threshold_raises_one_event);
+    RUN_TEST(test_health_default_drift_check);
+    RUN_TEST(test_health_wiper_move_not_flagged_by_default);
+    RUN_TEST(test_health_range_check);
+    RUN_TEST(test_health_summary_fits);
+    RUN_TEST(test_clock_discipline_tracks_offset_and_drift);
+    RUN_TEST(test_clock_discipline_rejects_slow_exchange);
+
+    return UNITY_END();
+}
@@ -0,0 +1,374 @@
+/*******************************************************************************
+Copyright 2022
+Steward Observatory Engineering & Technical Services, University of Arizona
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+#include <unity.h>
+
+#include "session_server.h"
+#include "message_router.h"
+#include "command_dispatcher.h"
+#include "voicecoil_iface_controller.h"
+#include "ptp_clock.h"
+#include "health_monitor.h"
+
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Session framing, roles and request dispatch, with the network replaced by
+// the in-memory sockets in native_stubs/NativeEthernet.h.
+
+using namespace LFAST;
+
+static const uint16_t CTRL_PORT = 14500;
+static const uint16_t TLM_PORT = 14501;
+
+/// Everything the router handlers saw, in order.
+static std::vector<std::string> routed;
+static int messagesBegun;
+static int messagesEnded;
+
+static void onSetTip(double val) { routed.push_back("SetTip=" + std::to_string(val)); }
+static void onHandshake(unsigned int val) { routed.push_back("Handshake=" + std::to_string(val)); }
+static void onBegin() { messagesBegun++; }
+static void onEnd() { messagesEnded++; }
+
+/// Controller glue as in main.cpp: each routed message is staged, then dispatched.
+static CommandDispatcher *testDispatcher;
+static void beginCommand() { testDispatcher->beginMessage(); }
+static void dispatchCommand() { testDispatcher->dispatch(); }
+static void stageTip(double val) { testDispatcher->stageSetpoint(TIP_AXIS, val); }
+static void stageTilt(double val) { testDispatcher->stageSetpoint(TILT_AXIS, val); }
+static void stageExecTime(double sec) { testDispatcher->setExecTime((int64_t)llround(sec * 1.0e9)); }
+
+static void setupControllerRouter(MessageRouter &router)
+{
+    router.registerMessageHandler<double>("ExecTime", stageExecTime);
+    router.registerMessageHandler<double>("SetTip", stageTip);
+    router.registerMessageHandler<double>("SetTilt", stageTilt);
+    router.setMessageHooks(beginCommand, dispatchCommand);
+}
+
+static std::size_t testFrame(char *buf, std::size_t len)
+{
+    return (std::size_t)snprintf(buf, len, "{\"Telemetry\":{}}");
+}
+
+void setUp(void)
+{
+    routed.clear();
+    messagesBegun = 0;
+    messagesEnded = 0;
+    nativePendingClients().clear();
+    PtpClock::getClock().reset();
+    HealthMonitor::getMonitor().reset();
+    VoiceCoilInterfaceController::getDeviceController().reset();
+}
+
+void tearDown(void)
+{
+}
+
+static void setupRouter(MessageRouter &router)
+{
+    router.registerMessageHandler<double>("SetTip", onSetTip);
+    router.registerMessageHandler<unsigned int>("Handshake", onHandshake);
+    router.setMessageHooks(onBegin, onEnd);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ByteRing
+///////////////////////////////////////////////////////////////////////////////
+
+void test_byte_ring_wraps_and_refuses_oversize(void)
+{
+    ByteRing<8> ring;
+    TEST_ASSERT_TRUE(ring.push("abcdef", 6));
+    ring.pop(4);
+    TEST_ASSERT_TRUE(ring.push("ghijkl", 6));
+    TEST_ASSERT_EQUAL_size_t(8, ring.size());
+    TEST_ASSERT_FALSE(ring.push("x", 1));
+
+    // The contents wrap, so they come out in two contiguous runs
+    std::size_t len;
+    const char *front = ring.front(len);
+    TEST_ASSERT_EQUAL_size_t(4, len);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(front, "efgh", 4));
+    ring.pop(len);
+    front = ring.front(len);
+    TEST_ASSERT_EQUAL_size_t(4, len);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(front, "ijkl", 4));
+    ring.pop(100);
+    TEST_ASSERT_EQUAL_size_t(0, ring.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MessageRouter and ReplyMessage
+///////////////////////////////////////////////////////////////////////////////
+
+void test_router_calls_handlers_in_key_order(void)
+{
+    MessageRouter router("Filter");
+    setupRouter(router);
+
+    TEST_ASSERT_TRUE(router.route("{\"Filter\": {\"Handshake\": 57005, \"SetTip\": -0.5}}"));
+    TEST_ASSERT_EQUAL_size_t(2, routed.size());
+    TEST_ASSERT_EQUAL_STRING("Handshake=57005", routed[0].c_str());
+    TEST_ASSERT_EQUAL_STRING(("SetTip=" + std::to_string(-0.5)).c_str(), routed[1].c_str());
+    TEST_ASSERT_EQUAL_INT(1, messagesBegun);
+    TEST_ASSERT_EQUAL_INT(1, messagesEnded);
+}
+
+void test_router_skips_unknown_and_non_numeric_keys(void)
+{
+    MessageRouter router("Filter");
+    setupRouter(router);
+
+    TEST_ASSERT_TRUE(router.route("{\"Filter\":{\"Other\":{\"a\":[1,\"}\"]},\"SetTip\":\"x\",\"Nope\":3,\"SetTip\":2}}"));
+    TEST_ASSERT_EQUAL_size_t(1, routed.size());
+    TEST_ASSERT_EQUAL_STRING(("SetTip=" + std::to_string(2.0)).c_str(), routed[0].c_str());
+    TEST_ASSERT_EQUAL_UINT32(3, router.unknownKeys());
+}
+
+void test_router_rejects_other_filters(void)
+{
+    MessageRouter router("Filter");
+    setupRouter(router);
+
+    TEST_ASSERT_FALSE(router.route("{\"OtherDevice\":{\"SetTip\":1}}"));
+    TEST_ASSERT_FALSE(router.route("{\"SetTip\":1}"));
+    TEST_ASSERT_EQUAL_size_t(0, routed.size());
+    TEST_ASSERT_EQUAL_INT(0, messagesBegun);
+    TEST_ASSERT_EQUAL_UINT32(2, router.rejectedMessages());
+}
+
+void test_reply_message_is_flat_json(void)
+{
+    ReplyMessage msg;
+    msg.addKeyValuePair<unsigned int>("Handshake", 0xBEEF);
+    msg.addKeyValuePair<double>("SyncT2", 0.25);
+    std::size_t len = 0;
+    const char *text = msg.finish(len);
+    TEST_ASSERT_NOT_NULL(text);
+    TEST_ASSERT_EQUAL_STRING("{\"Handshake\":48879,\"SyncT2\":0.25}", text);
+    TEST_ASSERT_EQUAL_size_t(strlen(text), len);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SessionServer: controller role
+///////////////////////////////////////////////////////////////////////////////
+
+void test_first_controller_takes_role_second_is_refused(void)
+{
+    SessionServer server(CTRL_PORT, TLM_PORT);
+    std::shared_ptr<NativeSocket> first = nativeQueueClient(CTRL_PORT);
+    server.service();
+    TEST_ASSERT_TRUE(server.controllerConnected());
+
+    std::shared_ptr<NativeSocket> second = nativeQueueClient(CTRL_PORT);
+    server.service();
+    TEST_ASSERT_TRUE(second->stopped);
+    TEST_ASSERT_TRUE(second->fromDevice.find("controller already connected") != std::string::npos);
+    TEST_ASSERT_FALSE(first->stopped);
+    TEST_ASSERT_EQUAL_UINT32(1, server.refusedControllers());
+
+    // Once the controller leaves, the role is free again
+    first->connected = false;
+    server.service();
+    TEST_ASSERT_FALSE(server.controllerConnected());
+    std::shared_ptr<NativeSocket> third = nativeQueueClient(CTRL_PORT);
+    server.service();
+    TEST_ASSERT_TRUE(server.controllerConnected());
+    TEST_ASSERT_FALSE(third->stopped);
+}
+
+void test_controller_replies_reach_only_the_controller(void)
+{
+    SessionServer server(CTRL_PORT, TLM_PORT);
+    std::shared_ptr<NativeSocket> subscriber = nativeQueueClient(TLM_PORT);
+    TEST_ASSERT_FALSE(server.sendToController("{}", 2));
+
+    std::shared_ptr<NativeSocket> controller = nativeQueueClient(CTRL_PORT);
+    server.service();
+    TEST_ASSERT_TRUE(server.sendToController("{\"Handshake\":48879}", 19));
+    server.service();
+    TEST_ASSERT_EQUAL_STRING("{\"Handshake\":48879}", controller->fromDevice.c_str());
+    TEST_ASSERT_EQUAL_size_t(0, subscriber->fromDevice.size());
+    TEST_ASSERT_EQUAL_UINT8(1, server.activeSessions());
+}
+
+void test_controller_messages_are_routed_one_at_a_time(void)
+{
+    SessionServer server(CTRL_PORT, TLM_PORT);
+    MessageRouter router("Filter");
+    setupRouter(router);
+    server.setControllerRouter(&router);
+
+    std::shared_ptr<NativeSocket> controller = nativeQueueClient(CTRL_PORT);
+    // Two messages in one read, the second split across reads
+    controller->toDevice = "{\"Filter\":{\"SetTip\":1}}{\"Filter\":{\"Hand";
+    server.service();
+    controller->toDevice += "shake\":57005}}";
+    server.service();
+
+    TEST_ASSERT_EQUAL_INT(2, messagesBegun);
+    TEST_ASSERT_EQUAL_INT(2, messagesEnded);
+    TEST_ASSERT_EQUAL_size_t(2, routed.size());
+    TEST_ASSERT_EQUAL_STRING("Handshake=57005", routed[1].c_str());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Controller messages through the dispatcher
+///////////////////////////////////////////////////////////////////////////////
+
+void test_batched_messages_are_dispatched_separately(void)
+{
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    vc.doInterruptStuff();
+    SetpointStats s0 = vc.getSetpointStats();
+
+    CommandDispatcher dispatcher(vc);
+    testDispatcher = &dispatcher;
+    SessionServer server(CTRL_PORT, TLM_PORT);
+    MessageRouter router("Filter");
+    setupControllerRouter(router);
+    server.setControllerRouter(&router);
+
+    // Both messages arrive in one read
+    std::shared_ptr<NativeSocket> controller = nativeQueueClient(CTRL_PORT);
+    controller->toDevice = "{\"Filter\":{\"SetTip\":1,\"SetTip\":2}}{\"Filter\":{\"SetTip\":3,\"SetTilt\":4}}";
+    server.service();
+    vc.doInterruptStuff();
+
+    // One token per message, and every setpoint is accounted for
+    TEST_ASSERT_EQUAL_UINT32(2, dispatcher.getSetpointRateLimit().allowed());
+    TEST_ASSERT_EQUAL_UINT32(4, dispatcher.receivedSetpoints());
+    TEST_ASSERT_EQUAL_UINT32(1, dispatcher.mergedSetpoints());
+    SetpointStats s1 = vc.getSetpointStats();
+    TEST_ASSERT_EQUAL_UINT32(3, s1.numPosted - s0.numPosted);
+    TEST_ASSERT_EQUAL_UINT32(1, s1.numMerged - s0.numMerged);
+    TEST_ASSERT_EQUAL_DOUBLE(3.0, vc.getSetpoint(TIP_AXIS));
+    TEST_ASSERT_EQUAL_DOUBLE(4.0, vc.getSetpoint(TILT_AXIS));
+}
+
+void test_exec_time_applies_only_to_its_own_message(void)
+{
+    PtpClock &clk = PtpClock::getClock();
+    clk.stampSyncRequest(clk.localNowNs());
+    clk.stampSyncReply();
+    TEST_ASSERT_TRUE(clk.completeSync(clk.localNowNs()));
+
+    VoiceCoilInterfaceController &vc = VoiceCoilInterfaceController::getDeviceController();
+    CommandDispatcher dispatcher(vc);
+    testDispatcher = &dispatcher;
+    SessionServer server(CTRL_PORT, TLM_PORT);
+    MessageRouter router("Filter");
+    setupControllerRouter(router);
+    server.setControllerRouter(&router);
+
+    // A timed move, then an immediate one, in a single read
+    char batch[160];
+    double later = (double)clk.hostNowNs() * 1.0e-9 + 3600.0;
+    snprintf(batch, sizeof(batch),
+             "{\"Filter\":{\"ExecTime\":%.6f,\"SetTip\":5}}{\"Filter\":{\"SetTilt\":6}}", later);
+    std::shared_ptr<NativeSocket> controller = nativeQueueClient(CTRL_PORT);
+    controller->toDevice = batch;
+    server.service();
+    vc.doInterruptStuff();
+
+    TEST_ASSERT_EQUAL_UINT32(1, vc.pendingCommands());
+    TEST_ASSERT_EQUAL_DOUBLE(6.0, vc.getSetpoint(TILT_AXIS));
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, vc.getSetpoint(TIP_AXIS));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SessionServer: telemetry sessions
+///////////////////////////////////////////////////////////////////////////////
+
+void test_subscriber_requests_are_framed_and_answered(void)
+{
+    SessionServer server(CTRL_PORT, TLM_PORT);
+    server.setTelemetrySource(testFrame);
+    std::shared_ptr<NativeSocket> sub = nativeQueueClient(TLM_PORT);
+
+    sub->toDevice = "junk {\"Ping\": 7}\n{\"GetTelemetry\": 0}{\"SetTip\": 1}";
+    server.service();
+    server.service();
+
+    TEST_ASSERT_TRUE(sub->fromDevice.find("{\"Pong\":7,\"Session\":1}") != std::string::npos);
+    TEST_ASSERT_TRUE(sub->fromDevice.find("{\"Telemetry\":{}}") != std::string::npos);
+    TEST_ASSERT_TRUE(sub->fromDevice.find("read-only session") != std::string::npos);
+    TEST_ASSERT_EQUAL_UINT32(3, server.getSession(1)->stats.requests);
+}
+
+void test_oversized_request_is_dropped_and_framing_resyncs(void)
+{
+    SessionServer server(CTRL_PORT, TLM_PORT);
+    std::shared_ptr<NativeSocket> sub = nativeQueueClient(TLM_PORT);
+
+    std::string huge = "{\"Ping\":\"" + std::string(SESSION_RX_BUF_SIZE * 2, 'x') + "\"}";
+    sub->toDevice = huge + "{\"Ping\": 3}";
+    for (int ii = 0; ii < 20; ii++)
+        server.service();
+
+    TEST_ASSERT_EQUAL_STRING("{\"Pong\":3,\"Session\":1}", sub->fromDevice.c_str());
+    TEST_ASSERT_EQUAL_UINT32(1, server.getSession(1)->stats.requests);
+}
+
+void test_slow_subscriber_drops_only_its_own_frames(void)
+{
+    SessionServer server(CTRL_PORT, TLM_PORT);
+    server.setTelemetrySource(testFrame);
+    std::shared_ptr<NativeSocket> slow = nativeQueueClient(TLM_PORT);
+    server.service();
+    std::shared_ptr<NativeSocket> fast = nativeQueueClient(TLM_PORT);
+    server.service();
+    slow->maxWrite = 0;
+
+    int frames = SESSION_TX_BUF_SIZE / 16 + 10;
+    for (int ii = 0; ii < frames; ii++)
+    {
+        slow->toDevice += "{\"GetTelemetry\":0}";
+        fast->toDevice += "{\"GetTelemetry\":0}";
+        server.service();
+    }
+
+    TEST_ASSERT_TRUE(server.getSession(1)->stats.framesDropped > 0);
+    TEST_ASSERT_EQUAL_UINT32(0, server.getSession(2)->stats.framesDropped);
+    TEST_ASSERT_EQUAL_size_t((std::size_t)frames * 16, fast->fromDevice.size());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_byte_ring_wraps_and_refuses_oversize);
+
+    RUN_TEST(test_router_calls_handlers_in_key_order);
+    RUN_TEST(test_router_skips_unknown_and_non_numeric_keys);
+    RUN_TEST(test_router_rejects_other_filters);
+    RUN_TEST(test_reply_message_is_flat_json);
+
+    RUN_TEST(test_first_controller_takes_role_second_is_refused);
+    RUN_TEST(test_controller_replies_reach_only_the_controller);
+    RUN_TEST(test_controller_messages_are_routed_one_at_a_time);
+
+    RUN_TEST(test_batched_messages_are_dispatched_separately);
+    RUN_TEST(test_exec_time_applies_only_to_its_own_message);
+
+    RUN_TEST(test_subscriber_requests_are_framed_and_answered);
+    RUN_TEST(test_oversized_request_is_dropped_and_framing_resyncs);
+    RUN_TEST(test_slow_subscriber_drops_only_its_own_frames);
+
+    return UNITY_END();
+}